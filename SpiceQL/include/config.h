@@ -0,0 +1,146 @@
+#pragma once
+/**
+  * @file
+  *
+  * In memory registry of the mission config files in the db directory. Used to
+  * avoid globbing and parsing the configs every time one is needed.
+  *
+ **/
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace SpiceQL {
+
+  /**
+   * @brief Singleton registry of the parsed mission configs
+   *
+   * Every config in the db directory is parsed the first time one is requested
+   * and shared, read only, from then on. Configs are never modified in place, a
+   * reload builds a new set, so a config that's been returned stays valid for as
+   * long as it's held even if the registry is reloaded.
+   *
+   * The configs are reloaded when the db directory changes, i.e. $SSPICE_DEBUG or
+   * $CONDA_PREFIX change, or when auto reload is on and a config file was added,
+   * removed or modified.
+   *
+   * @see getConfigDirectory
+   */
+  class ConfigRegistry {
+    public:
+
+    /**
+     * Delete constructors and such as this is a singleton
+     */
+    ConfigRegistry(ConfigRegistry const &other) = delete;
+    void operator=(ConfigRegistry const &other) = delete;
+
+
+    /**
+     * @brief Get the registry instance
+     *
+     * @return ConfigRegistry&
+     */
+    static ConfigRegistry &getInstance();
+
+
+    /**
+     * @brief Get a mission's config
+     *
+     * @param mission mission name, the config file's name without the extension
+     * @return std::shared_ptr<const nlohmann::json> the parsed config
+     * @throws std::invalid_argument if there's no config for the mission
+     */
+    std::shared_ptr<const nlohmann::json> getConfig(std::string const &mission);
+
+
+    /**
+     * @brief Get the path to a mission's config file
+     *
+     * @param mission mission name, the config file's name without the extension
+     * @return std::string path to the config file
+     * @throws std::invalid_argument if there's no config for the mission
+     */
+    std::string getConfigFile(std::string const &mission);
+
+
+    /**
+     * @brief Get every config
+     *
+     * @return std::vector<std::shared_ptr<const nlohmann::json>> parsed configs, same order as getConfigFiles
+     */
+    std::vector<std::shared_ptr<const nlohmann::json>> getConfigs();
+
+
+    /**
+     * @brief Get the paths to every config file
+     *
+     * @return std::vector<std::string> config file paths
+     */
+    std::vector<std::string> getConfigFiles();
+
+
+    /**
+     * @brief Turn checking for changed config files on every lookup on or off
+     *
+     * Off by default. When on, every lookup stats the db directory and config files,
+     * which is still much cheaper than parsing them.
+     *
+     * @param autoReload true to reload the configs whenever the files change
+     */
+    void setAutoReload(bool autoReload);
+
+
+    /**
+     * @brief Check if the configs are reloaded when the files change
+     *
+     * @return bool true if auto reload is on
+     */
+    bool getAutoReload();
+
+
+    /**
+     * @brief Reload the configs if any of the files changed
+     *
+     * @return bool true if the configs were reloaded
+     */
+    bool reload();
+
+    private:
+
+    //! configs parsed from one version of the db directory, defined in config.cpp
+    struct Snapshot;
+
+    ConfigRegistry() = default;
+
+
+    /**
+     * @brief Get the current configs, loading them if they're missing or out of date
+     */
+    std::shared_ptr<const Snapshot> get();
+
+
+    /**
+     * @brief Glob and parse the config files
+     */
+    static std::shared_ptr<const Snapshot> load();
+
+
+    /**
+     * @brief Check whether a snapshot no longer matches the db directory, lock must be held
+     *
+     * @param checkFiles if true, also compare the config files' modification times
+     */
+    bool isStale(Snapshot const &snapshot, bool checkFiles);
+
+    std::shared_ptr<const Snapshot> current;
+
+    bool autoReload = false;
+
+    std::mutex lock;
+  };
+}
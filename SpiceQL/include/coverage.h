@@ -0,0 +1,310 @@
+#pragma once
+/**
+  * @file
+  *
+  * Cache of binary kernel coverage. Used to avoid opening a kernel every time
+  * its time intervals are needed.
+  *
+ **/
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "paths.h"
+
+namespace SpiceQL {
+
+  /**
+   * @brief Coverage of a single kernel as recorded in the CoverageCache
+   */
+  struct KernelCoverage {
+    //! size of the kernel in bytes when the coverage was computed
+    std::uintmax_t size;
+    //! modification time of the kernel when the coverage was computed
+    std::int64_t mtime;
+    //! map of NAIF body code to the start and stop times covered for that body
+    std::map<int, std::vector<std::pair<double, double>>> bodies;
+    //! true if the times are encoded SCLK (CKs), they're converted to ET when read
+    bool sclk = false;
+  };
+
+
+  /**
+   * @brief Singleton cache of binary kernel coverage
+   *
+   * Coverage is computed the first time a kernel is requested and reused for as
+   * long as the kernel's size and modification time don't change.
+   *
+   * CK coverage is cached as encoded SCLK and converted to ET with the SCLK that's
+   * loaded when it's read, so the cache stays valid when the SCLK is updated.
+   *
+   * If $SSPICE_COVERAGE_CACHE is set, the cache is loaded from that file the first
+   * time it is used and any new coverage is written back to it when the process exits.
+   * Otherwise, use load and save to persist the cache.
+   *
+   * @see getTimeIntervals
+   */
+  class CoverageCache {
+    public:
+
+    /**
+     * Delete constructors and such as this is a singleton
+     */
+    CoverageCache(CoverageCache const &other) = delete;
+    void operator=(CoverageCache const &other) = delete;
+
+    /**
+     * @brief Get the coverage cache
+     *
+     * @return CoverageCache&
+     */
+    static CoverageCache &getInstance();
+
+
+    /**
+     * @brief Get the coverage of every body in a kernel
+     *
+     * If the kernel isn't in the cache or has changed since it was cached, the
+     * kernel is opened and its coverage is computed and cached. CK times are
+     * converted to ET, so the spacecraft's SCLK and an LSK need to be loaded.
+     *
+     * @param kpath path to the kernel
+     * @return map of NAIF body code to start and stop times in ET
+     */
+    std::map<int, std::vector<std::pair<double, double>>> getCoverage(KernelPath kpath);
+
+
+    /**
+     * @brief Look up a kernel without computing its coverage
+     *
+     * @param kpath path to the kernel
+     * @return the cached coverage as stored, CK times are still encoded SCLK. Empty if
+     *         the kernel isn't cached or changed since it was cached
+     */
+    std::optional<KernelCoverage> find(KernelPath kpath);
+
+
+    /**
+     * @brief Add a kernel's coverage to the cache
+     *
+     * The kernel's current size and modification time are recorded with the coverage.
+     *
+     * @param kpath path to the kernel
+     * @param bodies map of NAIF body code to start and stop times
+     * @param sclk true if the times are encoded SCLK rather than ET
+     */
+    void insert(KernelPath kpath, std::map<int, std::vector<std::pair<double, double>>> bodies, bool sclk = false);
+
+
+    /**
+     * @brief Add the entries in a cache file to the cache
+     *
+     * Entries already in memory are replaced. A missing or unreadable file is ignored,
+     * as are entries from older caches that stored CK coverage in ET.
+     *
+     * @param cachePath path to a file written by save
+     */
+    void load(std::string cachePath);
+
+
+    /**
+     * @brief Write the cache to disk as JSON
+     *
+     * @param cachePath path to write the cache to
+     */
+    void save(std::string cachePath);
+
+
+    /**
+     * @brief Remove every entry from the cache
+     */
+    void clear();
+
+
+    /**
+     * @brief Get the number of kernels in the cache
+     *
+     * @return size_t number of kernels
+     */
+    size_t size();
+
+
+    /**
+     * @brief Serialize the cache to JSON
+     *
+     * @return nlohmann::json the cache
+     */
+    nlohmann::json toJson();
+
+    private:
+
+    //! Singletons shouldn't be constructed from anywhere other than the getInstance() function.
+    CoverageCache();
+    ~CoverageCache();
+
+    //! guards entries and dirty
+    std::mutex lock;
+
+    //! map of kernel path to coverage
+    std::unordered_map<KernelPath, KernelCoverage> entries;
+
+    //! cache file from $SSPICE_COVERAGE_CACHE, empty if not set
+    std::string cachePath;
+
+    //! true if entries were added since the cache file was read
+    bool dirty = false;
+  };
+
+
+  /**
+   * @brief Index of kernel coverage intervals for fast time queries
+   *
+   * Every coverage interval of every kernel is stored in an interval tree, laid out
+   * as a sorted array where each node also records the largest stop time in its
+   * subtree. Queries for a time or a time range take O(log n + k) where n is the number
+   * of intervals and k is the number of matching intervals.
+   *
+   * Build one index per set of kernels (e.g. reconstructed CKs for an instrument) and
+   * query it as many times as needed.
+   *
+   * @see searchMissionKernels
+   */
+  class CoverageIndex {
+    public:
+
+    /**
+     * @brief Construct an empty index
+     */
+    CoverageIndex() = default;
+
+
+    /**
+     * @brief Construct an index over a list of binary kernels
+     *
+     * Coverage comes from getTimeIntervals, so kernels are only opened if they aren't
+     * already in the CoverageCache.
+     *
+     * @param kernels paths to the kernels to index
+     */
+    explicit CoverageIndex(std::vector<KernelPath> const &kernels);
+
+
+    /**
+     * @brief Construct an index over kernels whose coverage is already known
+     *
+     * The tree is built once, so this takes O(n log n) rather than the O(n^2) of
+     * adding the kernels one at a time.
+     *
+     * @param coverage kernel paths and the start and stop times each covers
+     */
+    explicit CoverageIndex(std::vector<std::pair<KernelPath, std::vector<std::pair<double, double>>>> const &coverage);
+
+
+    /**
+     * @brief Add a kernel and its coverage to the index
+     *
+     * Takes O(n) to keep the tree up to date, use the constructor to index many kernels at once.
+     *
+     * @param kernel path to the kernel
+     * @param intervals start and stop times covered by the kernel
+     */
+    void add(KernelPath kernel, std::vector<std::pair<double, double>> const &intervals);
+
+
+    /**
+     * @brief Get the kernels with coverage at a time
+     *
+     * @param time time to search for
+     * @return kernels covering the time, in the order they were added
+     */
+    std::vector<KernelPath> query(double time) const;
+
+
+    /**
+     * @brief Get the kernels with coverage overlapping a time range
+     *
+     * @param start start of the time range
+     * @param stop end of the time range
+     * @return kernels with coverage overlapping the range, in the order they were added
+     */
+    std::vector<KernelPath> query(double start, double stop) const;
+
+
+    /**
+     * @brief Get the kernels with coverage at a list of times
+     *
+     * Only intervals overlapping the first and last time are visited, and each is checked
+     * against the times with a binary search. Times that are already sorted, like line scan
+     * exposure times, aren't copied.
+     *
+     * @param times times to search for
+     * @param isContiguous if true, only kernels with a single interval covering every time are
+     *                     returned, else kernels covering at least one of the times are returned
+     * @return matching kernels, in the order they were added
+     */
+    std::vector<KernelPath> query(std::vector<double> const &times, bool isContiguous=false) const;
+
+
+    /**
+     * @brief Get the kernels in the index
+     *
+     * @return kernels in the order they were added
+     */
+    std::vector<KernelPath> const &getKernels() const;
+
+
+    /**
+     * @brief Get the number of intervals in the index
+     *
+     * @return size_t number of intervals
+     */
+    size_t size() const;
+
+    private:
+
+    //! Single coverage interval
+    struct Node {
+      double start;
+      double stop;
+      //! largest stop time in the subtree rooted at this node
+      double maxStop;
+      //! index into kernels
+      size_t kernel;
+    };
+
+    /**
+     * @brief Sort the nodes by start time and build the tree over all of them
+     */
+    void build();
+
+    /**
+     * @brief Compute maxStop for the subtree over nodes[lo, hi)
+     */
+    double buildSubtree(size_t lo, size_t hi);
+
+
+    /**
+     * @brief Collect the indices of the intervals in nodes[lo, hi) overlapping [start, stop]
+     */
+    void search(size_t lo, size_t hi, double start, double stop, std::vector<size_t> &hits) const;
+
+
+    /**
+     * @brief Convert marked kernels to paths
+     */
+    std::vector<KernelPath> collect(std::vector<bool> const &found) const;
+
+    //! kernel paths, in the order they were added
+    std::vector<KernelPath> kernels;
+
+    //! intervals sorted by start time, the root of the subtree over nodes[lo, hi) is at the midpoint
+    std::vector<Node> nodes;
+  };
+}
@@ -0,0 +1,58 @@
+#pragma once
+/**
+  * @file
+  *
+  * Native readers for kernel metadata. Used to get a kernel's type, bodies and
+  * coverage without furnishing it.
+  *
+  * @see MappedKernel
+  *
+ **/
+
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace SpiceQL {
+
+  /**
+   * @brief Get a kernel's type from the first line of the file
+   *
+   * Returns the same types as CSPICE's kinfo_c (SPK, CK, PCK, DSK, EK, TEXT or META),
+   * but without loading the kernel.
+   *
+   * @param kernelPath path to the kernel
+   * @return std::optional<std::string> the kernel type, empty if it can't be determined
+   *         without CSPICE, e.g. for old kernels without an ID word
+   */
+  std::optional<std::string> readKernelType(std::string kernelPath);
+
+
+  /**
+   * @brief Get the coverage of every body in a binary SPK or CK without loading it
+   *
+   * Segment start and stop times for each body are merged into windows, matching
+   * spkcov_c and ckcov_c at the segment level. SPK times are in ET. CK times are
+   * converted from encoded SCLK to ET unless convertSclk is false, converting needs
+   * the spacecraft's SCLK and an LSK to be loaded.
+   *
+   * @param kernelPath path to the kernel
+   * @param convertSclk if false, CK times are left as encoded SCLK
+   * @return map of NAIF body code to start and stop times
+   * @throws std::invalid_argument if the kernel isn't an SPK or CK DAF
+   */
+  std::map<int, std::vector<std::pair<double, double>>> readDafCoverage(std::string kernelPath, bool convertSclk = true);
+
+
+  /**
+   * @brief Convert CK coverage from encoded SCLK to ET
+   *
+   * Each body's clock comes from ckmeta_c, so the spacecraft's SCLK and an LSK need
+   * to be loaded.
+   *
+   * @param coverage map of NAIF body code to start and stop times, converted in place
+   */
+  void sclkToEt(std::map<int, std::vector<std::pair<double, double>>> &coverage);
+}
@@ -0,0 +1,326 @@
+#pragma once
+/**
+  * @file
+  *
+  * Interpolating caches for dense state and orientation sampling. Used when many
+  * states or orientations are needed over a short time range, e.g. for every line
+  * of a line scan image.
+  *
+ **/
+
+#include <array>
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "utils.h"
+
+namespace SpiceQL {
+
+  /**
+   * @brief Cache of target states that interpolates between samples
+   *
+   * States are sampled once at a fixed cadence over a time range and stored.
+   * Queries inside the time range are answered with a cubic Hermite polynomial
+   * through the positions and velocities at the surrounding samples, the same
+   * interpolation SPK type 13 segments use, so no CSPICE calls are made.
+   *
+   * The interpolation error is checked against a sample at the midpoint of every
+   * interval, where the Hermite error peaks. If a tolerance is set, intervals with
+   * a larger error are split until the error is within it.
+   *
+   * @see getTargetStates
+   */
+  class CachedEphemeris {
+    public:
+
+    /**
+     * @brief Function that returns the states at a list of times, like getTargetStates
+     */
+    using Sampler = std::function<targetStates(std::span<const double>)>;
+
+
+    /**
+     * @brief Construct a cache of the state of a target relative to an observer
+     *
+     * Kernels covering the time range need to be furnished.
+     *
+     * @param target NAIF name or ID for the target
+     * @param observer NAIF name or ID for the observer
+     * @param startEt start of the time range
+     * @param stopEt end of the time range
+     * @param cadence seconds between samples
+     * @param frame The reference frame in which to get the positions in
+     * @param abcorr aborration correction flag, default it NONE. See getTargetState
+     * @param tolerance largest allowed position error in km, 0 to not refine the samples
+     * @throws std::invalid_argument if the target, observer or frame is unknown, or the
+     *         time range or cadence are invalid
+     */
+    CachedEphemeris(std::string target, std::string observer, double startEt, double stopEt, double cadence,
+                    std::string frame="J2000", std::string abcorr="NONE", double tolerance=0);
+
+
+    /**
+     * @brief Construct a cache over states from any source
+     *
+     * @param sampler function returning the states at a list of times
+     * @param startEt start of the time range
+     * @param stopEt end of the time range
+     * @param cadence seconds between samples
+     * @param tolerance largest allowed position error, 0 to not refine the samples
+     * @throws std::invalid_argument if the time range or cadence are invalid
+     */
+    CachedEphemeris(Sampler sampler, double startEt, double stopEt, double cadence, double tolerance=0);
+
+
+    /**
+     * @brief Get the state at a time
+     *
+     * Times outside of the cached range are sampled directly.
+     *
+     * @param et ephemeris time
+     * @return targetState interpolated state and light time
+     */
+    targetState getState(double et) const;
+
+
+    /**
+     * @brief Get the states at many times
+     *
+     * @param ets ephemeris times, faster if sorted
+     * @return targetStates interpolated states and light times
+     */
+    targetStates getStates(std::span<const double> ets) const;
+
+
+    /**
+     * @brief Get the largest position error found when validating the cache
+     *
+     * @return double largest distance between an interpolated and sampled position,
+     *         in the units of the samples (km for SPICE states)
+     */
+    double getMaxError() const;
+
+
+    /**
+     * @brief Get the number of times sampled while building the cache
+     *
+     * Includes the samples used to validate the cache, but not queries outside of
+     * the cached range.
+     *
+     * @return size_t number of sampled times
+     */
+    size_t getSampleCount() const;
+
+
+    /**
+     * @brief Get the number of samples stored in the cache
+     *
+     * @return size_t number of stored samples
+     */
+    size_t size() const;
+
+
+    //! @cond Doxygen_Suppress
+    double getStartTime() const { return startEt; }
+    double getStopTime() const { return stopEt; }
+    //! @endcond
+
+    private:
+
+    /**
+     * @brief Sample the time range and refine the intervals until they are within tolerance
+     */
+    void build(double cadence, double tolerance);
+
+
+    /**
+     * @brief Interpolate the state in the interval starting at samples[i]
+     *
+     * @param i index of the first sample of the interval
+     * @param et time inside the interval
+     * @param out 7 values, x, y, z, vx, vy, vz and light time
+     */
+    void interpolate(size_t i, double et, double *out) const;
+
+    //! source of the states
+    Sampler sampler;
+
+    double startEt;
+    double stopEt;
+
+    //! sample times, sorted
+    std::vector<double> times;
+
+    //! x, y, z, vx, vy, vz and light time for each sample
+    std::vector<std::array<double, 7>> samples;
+
+    double maxError = 0;
+    size_t sampleCount = 0;
+  };
+
+
+  /**
+   * @brief Cache of frame orientations that interpolates between samples
+   *
+   * Orientations are sampled once at a list of times, e.g. a fixed cadence or the
+   * boundaries of the CK segments covering an image, and stored. Queries between two
+   * samples are answered by interpolating the rotation between them, so no CSPICE
+   * calls are made.
+   *
+   * When the angular velocity is available at both samples, the rotation vector from
+   * the first sample is interpolated with a cubic Hermite polynomial matching the
+   * angular velocities at both ends. Otherwise the quaternions are interpolated with
+   * SLERP. Every interval is checked against a sample at its midpoint and uses
+   * whichever method was more accurate there. If neither is within the tolerance,
+   * queries in that interval fall back to getTargetOrientations.
+   *
+   * @see getTargetOrientations
+   */
+  class CachedOrientation {
+    public:
+
+    /**
+     * @brief Function that writes orientations to caller buffers, like getTargetOrientations
+     *
+     * Takes the times and the Nx4 quaternion and Nx3 angular velocity buffers, and returns
+     * the number of times without an angular velocity.
+     */
+    using Sampler = std::function<size_t(std::span<const double>, std::span<double>, std::span<double>)>;
+
+
+    /**
+     * @brief Construct a cache of a frame's orientation sampled at a fixed cadence
+     *
+     * Kernels covering the time range need to be furnished.
+     *
+     * @param toFrame the source frame's NAIF code.
+     * @param refFrame the reference frame's NAIF code, orientations are relative to this reference frame
+     * @param startEt start of the time range
+     * @param stopEt end of the time range
+     * @param cadence seconds between samples
+     * @param tolerance largest allowed interpolation error in radians, 0 to never fall back
+     * @throws std::invalid_argument if the time range or cadence are invalid
+     */
+    CachedOrientation(int toFrame, int refFrame, double startEt, double stopEt, double cadence, double tolerance=0);
+
+
+    /**
+     * @brief Construct a cache of a frame's orientation sampled at specific times
+     *
+     * Use to sample at CK segment boundaries or record times, where the attitude can change
+     * abruptly. The times don't need to be sorted.
+     *
+     * @param toFrame the source frame's NAIF code.
+     * @param refFrame the reference frame's NAIF code, orientations are relative to this reference frame
+     * @param times times to sample
+     * @param tolerance largest allowed interpolation error in radians, 0 to never fall back
+     * @throws std::invalid_argument if times is empty
+     */
+    CachedOrientation(int toFrame, int refFrame, std::vector<double> times, double tolerance=0);
+
+
+    /**
+     * @brief Construct a cache over orientations from any source
+     *
+     * Angular velocities are expected in the reference frame, as returned by getTargetOrientations.
+     *
+     * @param sampler function writing the orientations at a list of times
+     * @param times times to sample
+     * @param tolerance largest allowed interpolation error in radians, 0 to never fall back
+     * @throws std::invalid_argument if times is empty
+     */
+    CachedOrientation(Sampler sampler, std::vector<double> times, double tolerance=0);
+
+
+    /**
+     * @brief Get the orientation at a time
+     *
+     * @param et ephemeris time
+     * @return targetOrientation SPICE-style quaternion (w,x,y,z) and optional angular velocity
+     */
+    targetOrientation getOrientation(double et) const;
+
+
+    /**
+     * @brief Get the orientations at many times
+     *
+     * Same buffers as getTargetOrientations. Times outside of the sampled range or in
+     * intervals that failed the accuracy check are sampled directly, in one call.
+     *
+     * @param ets ephemeris times, faster if sorted
+     * @param quats output buffer for Nx4 SPICE-style quaternions (w,x,y,z), row major
+     * @param avs output buffer for Nx3 angular velocities, row major. If empty, angular
+     *            velocities aren't computed
+     * @returns number of times without an angular velocity, 0 if avs is empty
+     * @throws std::invalid_argument if the buffers are too small
+     */
+    size_t getOrientations(std::span<const double> ets, std::span<double> quats, std::span<double> avs) const;
+
+
+    /**
+     * @brief Get the largest rotation error found when validating the cache
+     *
+     * Intervals that fall back to direct calls aren't included.
+     *
+     * @return double largest angle between an interpolated and sampled orientation, in radians
+     */
+    double getMaxError() const;
+
+
+    /**
+     * @brief Get the number of intervals that fall back to direct calls
+     *
+     * @return size_t number of intervals outside of the tolerance
+     */
+    size_t getDirectIntervals() const;
+
+
+    /**
+     * @brief Get the number of samples stored in the cache
+     *
+     * @return size_t number of stored samples
+     */
+    size_t size() const;
+
+    private:
+
+    //! how queries in an interval are answered
+    enum Method {HERMITE, SLERP, DIRECT};
+
+    /**
+     * @brief Sample the times and pick the interpolation method for each interval
+     */
+    void build(double tolerance);
+
+
+    /**
+     * @brief Interpolate the orientation in the interval starting at times[i]
+     *
+     * @param i index of the first sample of the interval
+     * @param method interpolation method to use, HERMITE or SLERP
+     * @param et time inside the interval
+     * @param quat output quaternion
+     * @param av output angular velocity, linearly interpolated
+     */
+    void interpolate(size_t i, Method method, double et, double *quat, double *av) const;
+
+    //! source of the orientations
+    Sampler sampler;
+
+    //! sample times, sorted
+    std::vector<double> times;
+
+    //! quaternion for each sample
+    std::vector<std::array<double, 4>> quats;
+
+    //! angular velocity for each sample, NaN if it couldn't be computed
+    std::vector<std::array<double, 3>> avs;
+
+    //! method for each interval, by the index of its first sample
+    std::vector<Method> methods;
+
+    double maxError = 0;
+  };
+}
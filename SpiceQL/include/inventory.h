@@ -0,0 +1,206 @@
+#pragma once
+/**
+  * @file
+  *
+  * Persistent index of the kernels available in a data area. Used to avoid
+  * walking the entire data area on every kernel query.
+  *
+ **/
+
+#include <cstdint>
+#include <map>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace SpiceQL {
+
+  /**
+   * @brief Metadata for a single file tracked by a KernelInventory
+   */
+  struct InventoryEntry {
+    //! full path to the kernel
+    std::string path;
+    //! size of the file in bytes
+    std::uintmax_t size;
+    //! last modification time of the file, used to detect changes
+    std::int64_t mtime;
+    //! kernel type as a lower case string (e.g. "ck", "spk"), "na" if it could not be determined
+    std::string type;
+    //! first directory under the inventory root (e.g. "lro" in $ISISDATA/lro/kernels/ck/...)
+    std::string mission;
+  };
+
+
+  /**
+   * @brief Persistent, incrementally refreshed index of the files in a data area
+   *
+   * The data area is walked once and every file is recorded along with its
+   * size, modification time, kernel type and mission. The index can be written
+   * to disk and loaded in later processes, in which case only the files and
+   * directories whose modification times changed are re-examined.
+   *
+   * Kernel queries can then be run against the in-memory index instead of
+   * the file system.
+   *
+   * @see globKernels
+   * @see searchMissionKernels
+   */
+  class KernelInventory {
+    public:
+
+    /**
+     * @brief Construct an inventory for a data area
+     *
+     * If indexPath points to an existing index for the same root, the index is loaded
+     * and refreshed, otherwise the root is walked and a new index is created. If
+     * indexPath is not empty, the up to date index is written back to it.
+     *
+     * @param root root directory of the data area
+     * @param indexPath path to the on-disk index, if empty the index is only held in memory
+     */
+    explicit KernelInventory(std::string root, std::string indexPath="");
+
+
+    /**
+     * @brief Bring the index up to date with the file system
+     *
+     * Files that no longer exist are removed and files whose size or modification time
+     * changed are re-examined. Only directories whose modification times changed are listed
+     * again to find new files and subdirectories.
+     *
+     * @return true if the index changed
+     */
+    bool refresh();
+
+
+    /**
+     * @brief Write the index to disk as JSON
+     *
+     * @param indexPath path to write the index to
+     */
+    void save(std::string indexPath) const;
+
+
+    /**
+     * @brief Get the paths of all the files in the index
+     *
+     * The list is kept up to date with the index, so it isn't rebuilt on every call.
+     *
+     * @return std::vector<std::string> const& sorted list of paths
+     */
+    std::vector<std::string> const &getPaths() const;
+
+
+    /**
+     * @brief Get the paths of the files with one of the types and missions
+     *
+     * @param types lower case kernel types, see guessKernelType. If empty, every type matches
+     * @param missions missions the files have to be in, see InventoryEntry::mission. If empty,
+     *                 every mission matches
+     * @return std::vector<std::string> sorted list of paths
+     */
+    std::vector<std::string> getPaths(std::vector<std::string> const &types, std::vector<std::string> const &missions) const;
+
+
+    /**
+     * @brief glob, but against the index instead of the file system
+     *
+     * @param reg std::regex object to pattern to search
+     * @returns list of paths matching regex
+     */
+    std::vector<std::string> glob(std::regex const &reg) const;
+
+
+    /**
+     * @brief Get the entries of a single kernel type
+     *
+     * @param type lower case kernel type, e.g. "ck"
+     * @return std::vector<InventoryEntry> entries with the matching type
+     */
+    std::vector<InventoryEntry> getEntries(std::string type) const;
+
+
+    /**
+     * @brief Get every entry in the index
+     *
+     * @return map of file path to file metadata
+     */
+    std::map<std::string, InventoryEntry> const &getEntries() const;
+
+
+    /**
+     * @brief Get the directories in the index
+     *
+     * @return map of directory path to directory modification time
+     */
+    std::map<std::string, std::int64_t> const &getDirectories() const;
+
+
+    /**
+     * @brief Get the root of the data area
+     *
+     * @return std::string normalized root directory
+     */
+    std::string const &getRoot() const;
+
+
+    /**
+     * @brief Serialize the index to JSON
+     *
+     * @return nlohmann::json the index
+     */
+    nlohmann::json toJson() const;
+
+
+    /**
+     * @brief Guess a file's kernel type from its location and extension
+     *
+     * Files under a directory named after a kernel type (e.g. kernels/ck/) take on that
+     * type, otherwise the type is inferred from the NAIF recommended file extension.
+     * This does not open the file.
+     *
+     * @param path path to the kernel
+     * @return std::string lower case kernel type, "na" if it can't be determined
+     */
+    static std::string guessKernelType(std::string path);
+
+    private:
+
+    //! root directory of the data area
+    std::string root;
+
+    //! map of file path to file metadata
+    std::map<std::string, InventoryEntry> entries;
+
+    //! map of directory path to directory modification time
+    std::map<std::string, std::int64_t> directories;
+
+    //! paths of every entry, rebuilt whenever entries changes
+    std::vector<std::string> paths;
+
+    /**
+     * @brief Recursively add a directory and its contents to the index
+     *
+     * @param dir directory to add
+     */
+    void scanDirectory(std::string dir);
+
+
+    /**
+     * @brief Create an entry for a file
+     *
+     * @param path path to the file
+     * @return InventoryEntry entry for the file
+     */
+    InventoryEntry makeEntry(std::string path) const;
+
+
+    /**
+     * @brief Rebuild the list of paths from the entries
+     */
+    void updatePaths();
+  };
+}
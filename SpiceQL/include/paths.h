@@ -0,0 +1,181 @@
+#pragma once
+/**
+  * @file
+  *
+  * Interned kernel paths. Every path is stored once in a global table and passed
+  * around as a pointer sized handle, so the kernel pool, coverage cache and query
+  * results hash and compare pointers instead of strings.
+  *
+ **/
+
+#include <compare>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace SpiceQL {
+
+  /**
+   * @brief Handle to an interned kernel path
+   *
+   * Two handles are equal if and only if their paths are, comparing them is a pointer
+   * comparison. Handles are ordered by their paths so sorted containers of them are
+   * in the same order as the strings would be.
+   *
+   * Strings convert to handles implicitly so functions taking a KernelPath can still
+   * be called with a std::string.
+   */
+  class KernelPath {
+    public:
+
+    /**
+     * @brief Construct an empty path
+     */
+    KernelPath();
+
+
+    /**
+     * @brief Intern a path
+     *
+     * @param path path to intern, copied into the PathTable the first time it's seen
+     */
+    KernelPath(std::string_view path);
+
+    //! @see KernelPath(std::string_view)
+    KernelPath(std::string const &path);
+
+    //! @see KernelPath(std::string_view)
+    KernelPath(char const *path);
+
+    //! @see KernelPath(std::string_view), for anything else that converts to a string, like a filesystem path
+    template<typename T>
+    requires std::is_convertible_v<T const &, std::string>
+    KernelPath(T const &path) : KernelPath(std::string(path)) { }
+
+
+    /**
+     * @brief Get the path
+     *
+     * @return std::string const& the interned string, valid for the life of the process
+     */
+    std::string const &str() const { return *path; }
+
+    //! @see str
+    operator std::string const &() const { return *path; }
+
+    //! @see str
+    char const *c_str() const { return path->c_str(); }
+
+    //! true if the path is the empty string
+    bool empty() const { return path->empty(); }
+
+    bool operator==(KernelPath const &other) const { return path == other.path; }
+
+    std::strong_ordering operator<=>(KernelPath const &other) const;
+
+    private:
+    friend struct std::hash<KernelPath>;
+
+    //! the string in the PathTable
+    std::string const *path;
+  };
+
+
+  /**
+   * @brief Global table of interned kernel paths
+   *
+   * Paths are never removed, a handle stays valid for the life of the process.
+   * Interning is thread safe, reading an interned path doesn't need a lock.
+   */
+  class PathTable {
+    public:
+
+    /**
+     * Delete constructors and such as this is a singleton
+     */
+    PathTable(PathTable const &other) = delete;
+    void operator=(PathTable const &other) = delete;
+
+
+    /**
+     * @brief Get the PathTable
+     *
+     * The table is never destroyed, so handles held by other singletons are still
+     * valid while they're destroyed.
+     *
+     * @return PathTable& the global table
+     */
+    static PathTable &getInstance();
+
+
+    /**
+     * @brief Get the interned copy of a path, adding it if it isn't in the table
+     *
+     * @param path path to intern
+     * @return std::string const* the interned string
+     */
+    std::string const *intern(std::string_view path);
+
+
+    /**
+     * @brief Get the number of interned paths
+     *
+     * @return size_t number of unique paths
+     */
+    size_t size();
+
+    private:
+
+    //! Singletons shouldn't be constructed from anywhere other than the getInstance() function.
+    PathTable() = default;
+
+    //! guards paths and index
+    std::mutex lock;
+
+    //! interned strings, a deque so they never move as it grows
+    std::deque<std::string> paths;
+
+    //! views of the strings in paths to their position
+    std::unordered_map<std::string_view, std::string const *> index;
+  };
+
+
+  /**
+   * @brief Intern a json list of paths
+   *
+   * Same as jsonArrayToVector but interns the strings.
+   *
+   * @param arr json array of strings, or a single string
+   * @return std::vector<KernelPath> the interned paths
+   */
+  std::vector<KernelPath> jsonArrayToPaths(nlohmann::json const &arr);
+
+
+  //! json conversion, paths are written as strings
+  void to_json(nlohmann::json &j, KernelPath const &path);
+
+  //! json conversion, paths are read from strings
+  void from_json(nlohmann::json const &j, KernelPath &path);
+
+  std::ostream &operator<<(std::ostream &os, KernelPath const &path);
+}
+
+
+/**
+ * @brief Hash of the handle, interned paths are unique so the pointer is enough
+ */
+template<>
+struct std::hash<SpiceQL::KernelPath> {
+  size_t operator()(SpiceQL::KernelPath const &path) const noexcept {
+    return std::hash<std::string const *>()(path.path);
+  }
+};
@@ -11,6 +11,8 @@
 #include <iostream>
 #include <nlohmann/json.hpp>
 
+#include "inventory.h"
+#include "results.h"
 #include "spice_types.h"
 
 
@@ -42,6 +44,17 @@ namespace SpiceQL {
   nlohmann::json getLatestKernels(nlohmann::json kernels);
 
 
+  /**
+    * @brief returns only the latest version of each kernel type
+    *
+    * Same as getLatestKernels(nlohmann::json) for typed results.
+    *
+    * @param kernels kernels to reduce
+    * @returns the kernels with reduced kernel sets
+   **/
+  KernelQueryResult getLatestKernels(KernelQueryResult kernels);
+
+
   /**
     * @brief return's kernel values in the form of a vector 
     *
@@ -96,6 +109,71 @@ namespace SpiceQL {
   nlohmann::json searchMissionKernels(nlohmann::json conf);
 
 
+  /**
+   * @brief Returns all kernels available for a mission
+   *
+   * Same as searchMissionKernels(std::string, nlohmann::json) except the kernels
+   * are matched against an existing listing of files. Use this to run multiple
+   * searches against a single walk of the data area.
+   *
+   * @param files listing of the files to search, usually from ls
+   * @param conf json conf file
+   * @returns list of paths matching ext
+  **/
+  nlohmann::json searchMissionKernels(std::vector<std::string> const &files, nlohmann::json conf);
+
+
+  /**
+   * @brief Returns all kernels available for a mission
+   *
+   * Same as searchMissionKernels(std::string, nlohmann::json) except the kernels
+   * are found in the inventory's index instead of by walking the file system.
+   *
+   * @param inventory index of the data area to search
+   * @param conf json conf file
+   * @param missions only search files in these missions, see InventoryEntry::mission.
+   *                 If empty, every file in the index is searched
+   * @returns list of paths matching ext
+  **/
+  nlohmann::json searchMissionKernels(KernelInventory const &inventory, nlohmann::json conf, std::vector<std::string> const &missions={});
+
+
+  /**
+   * @brief Get the directories a mission's kernels can be in
+   *
+   * Assumes the data area is laid out like the ISIS data area, i.e. kernels
+   * are in root/<mission>/kernels/<type>/. Only directories for the kernel types
+   * the config has patterns for are returned. If a mission has no kernels directory,
+   * the entire mission directory is returned.
+   *
+   * The top level keys in a config are instruments, not directories, so the mission
+   * directories have to be given, e.g. "lro" or "messenger". Missions without a
+   * directory under root are skipped. If none of them have one, nothing can be pruned
+   * and only the root is returned.
+   *
+   * @param root root path of the data area
+   * @param conf json conf file
+   * @param missions names of the mission directories under root
+   * @returns list of directories to search
+  **/
+  std::vector<std::string> getKernelDirectories(std::string root, nlohmann::json conf, std::vector<std::string> missions);
+
+
+  /**
+   * @brief Returns all kernels available for a mission, only searching the mission's directories
+   *
+   * Same as searchMissionKernels(std::string, nlohmann::json) except only the directories
+   * from getKernelDirectories are walked, and the regexes are only matched against
+   * file names instead of full paths.
+   *
+   * @param root root path of the data area
+   * @param conf json conf file
+   * @param missions names of the mission directories under root, see getKernelDirectories
+   * @returns list of paths matching ext
+  **/
+  nlohmann::json searchMissionDirectories(std::string root, nlohmann::json conf, std::vector<std::string> missions);
+
+
   /**
    * @brief Returns all kernels available in the time range
    *
@@ -105,14 +183,54 @@ namespace SpiceQL {
    * TODO: Add a "See Also" on json format after the format matures a bit more.
    *
    * @param kernels kernels to search
-   * @param times vector of times to match
-   * @param isContiguous if true, all times need to be in the kernel to match the query, else, any kernel that
-   *                     is in any of the times inputed get returned
+   * @param times vector of times to match, they don't need to be sorted
+   * @param isContiguous if true, all times need to be in a single coverage interval of the kernel to match the
+   *                     query, else, any kernel that is in any of the times inputed get returned
    * @returns json object with new kernels
   **/
   nlohmann::json searchMissionKernels(nlohmann::json kernels, std::vector<double> times, bool isContiguous=false);
 
 
+  /**
+   * @brief Returns all kernels available for a mission as typed results
+   *
+   * Same as searchMissionKernels(std::string, nlohmann::json) without building the json,
+   * use KernelQueryResult::toJson where json is needed.
+   *
+   * @param root root path to search
+   * @param conf json conf file
+   * @returns kernels matching the config
+  **/
+  KernelQueryResult queryMissionKernels(std::string root, nlohmann::json const &conf);
+
+
+  /**
+   * @brief Returns all kernels available for a mission as typed results
+   *
+   * Same as searchMissionKernels(std::vector<std::string> const&, nlohmann::json) without
+   * building the json.
+   *
+   * @param files listing of the files to search, usually from ls
+   * @param conf json conf file
+   * @returns kernels matching the config
+  **/
+  KernelQueryResult queryMissionKernels(std::vector<std::string> const &files, nlohmann::json const &conf);
+
+
+  /**
+   * @brief Returns all kernels available in the time range as typed results
+   *
+   * Same as searchMissionKernels(nlohmann::json, std::vector<double>, bool), the ck and spk
+   * quality lists are reduced to the kernels with coverage at the times.
+   *
+   * @param kernels kernels to search
+   * @param times vector of times to match, they don't need to be sorted
+   * @param isContiguous if true, all times need to be in a single coverage interval of the kernel to match
+   * @returns the kernels with reduced ck and spk lists
+  **/
+  KernelQueryResult queryMissionKernels(KernelQueryResult kernels, std::vector<double> times, bool isContiguous=false);
+
+
   /**
     * @brief acquire all kernels of a type according to a configuration JSON object
     *
@@ -125,5 +243,35 @@ namespace SpiceQL {
     * @param kernelType Some CK kernel type, see Kernel::TYPES
    **/
   nlohmann::json globKernels(std::string root, nlohmann::json conf, std::string kernelType);
+
+
+  /**
+    * @brief acquire all kernels of a type according to a configuration JSON object
+    *
+    * Same as globKernels(std::string, nlohmann::json, std::string) except the kernels
+    * are matched against an existing listing of files instead of walking the root.
+    *
+    * @param files listing of the files to search, usually from ls
+    * @param conf JSON config file, usually this is a JSON object read from one of the db files that shipped with the library
+    * @param kernelType Some CK kernel type, see Kernel::TYPES
+   **/
+  nlohmann::json globKernels(std::vector<std::string> const &files, nlohmann::json conf, std::string kernelType);
+
+
+  /**
+    * @brief acquire all kernels of a type according to a configuration JSON object
+    *
+    * Same as globKernels(std::string, nlohmann::json, std::string) except the kernels
+    * are found in the inventory's index instead of by walking the file system. Only
+    * files whose type in the index can hold kernels of the requested type are matched.
+    *
+    * @param inventory index of the data area to search
+    * @param conf JSON config file, usually this is a JSON object read from one of the db files that shipped with the library
+    * @param kernelType Some CK kernel type, see Kernel::TYPES
+    * @param missions only search files in these missions, see InventoryEntry::mission.
+    *                 If empty, files in every mission are searched
+   **/
+  nlohmann::json globKernels(KernelInventory const &inventory, nlohmann::json conf, std::string kernelType,
+                             std::vector<std::string> const &missions={});
   
   }
@@ -0,0 +1,126 @@
+#pragma once
+/**
+  * @file
+  *
+  * Typed kernel query results. Queries build and filter these directly, they're
+  * only converted to json where a json result is returned.
+  *
+ **/
+
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "paths.h"
+
+namespace SpiceQL {
+
+  /**
+   * @brief Kernels found for one quality of a kernel type, or for the kernel type itself
+   *
+   * Members are only set if the config had patterns, or deps, for them.
+   */
+  struct KernelList {
+    //! kernels matching the "kernels" patterns
+    std::optional<std::vector<KernelPath>> kernels;
+    //! kernels matching the "deps/sclk" patterns
+    std::optional<std::vector<KernelPath>> sclk;
+    //! kernels matching the "deps/pck" patterns
+    std::optional<std::vector<KernelPath>> pck;
+    //! "deps/objs", json pointers to other configs these kernels depend on
+    std::optional<std::vector<std::string>> objs;
+
+    bool operator==(KernelList const &other) const = default;
+  };
+
+
+  /**
+   * @brief Kernels found for a kernel type by quality, the empty quality is the kernel type's own list
+   */
+  typedef std::map<std::string, KernelList> KernelQualities;
+
+
+  /**
+   * @brief Kernels found by a query, by instrument, kernel type and quality
+   *
+   * Mirrors the json returned by searchMissionKernels, e.g. the json path
+   * "/lroc/ck/reconstructed/kernels" is instruments["lroc"]["ck"]["reconstructed"].kernels.
+   * Maps are ordered the same way nlohmann::json orders keys, so converting to json
+   * and back doesn't change the order of anything.
+   */
+  struct KernelQueryResult {
+    //! instrument -> kernel type -> quality -> kernels. The instrument is the json pointer to the
+    //! kernel type's parent without the leading '/', for a mission config that's the instrument name
+    std::map<std::string, std::map<std::string, KernelQualities>> instruments;
+
+
+    /**
+     * @brief Get a kernel list, adding it if it doesn't exist
+     *
+     * @param instrument instrument name
+     * @param type kernel type, see Kernel::TYPES
+     * @param quality kernel quality, see Kernel::QUALITIES, empty for the kernel type's own list
+     * @return KernelList& the list
+     */
+    KernelList &at(std::string const &instrument, std::string const &type, std::string const &quality="");
+
+
+    /**
+     * @brief Find a kernel list
+     *
+     * @return const KernelList* the list, nullptr if there isn't one
+     * @see at
+     */
+    const KernelList *find(std::string const &instrument, std::string const &type, std::string const &quality="") const;
+
+
+    /**
+     * @brief Get every kernel in the "kernels" lists
+     *
+     * @return std::vector<KernelPath> kernels in the order KernelSet loads them
+     */
+    std::vector<KernelPath> getKernels() const;
+
+
+    /**
+     * @brief Get the json pointer to a list's kernels
+     *
+     * @return std::string pointer to the "kernels" key, e.g. "/lroc/ck/reconstructed/kernels"
+     */
+    static std::string getPointer(std::string const &instrument, std::string const &type, std::string const &quality="");
+
+
+    /**
+     * @brief Get the instrument a kernel type belongs to
+     *
+     * @param typePointer json pointer to the kernel type, e.g. "/lroc/ck"
+     * @return std::string the instrument, see instruments
+     */
+    static std::string getInstrument(nlohmann::json::json_pointer const &typePointer);
+
+
+    /**
+     * @brief Convert to the json returned by the query functions
+     *
+     * @return nlohmann::json kernel lists, an empty object if there are none
+     */
+    nlohmann::json toJson() const;
+
+
+    /**
+     * @brief Read the kernel lists from json returned by the query functions
+     *
+     * Kernel types are found anywhere in the json, keys that aren't kernel types, qualities
+     * "kernels" or "deps" are ignored.
+     *
+     * @param kernels json kernel lists, single kernels can be strings instead of lists
+     * @return KernelQueryResult the typed results
+     */
+    static KernelQueryResult fromJson(nlohmann::json const &kernels);
+
+    bool operator==(KernelQueryResult const &other) const = default;
+  };
+}
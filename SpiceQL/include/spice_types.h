@@ -5,11 +5,23 @@
   *
  **/
 
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <nlohmann/json.hpp>
 
+#include "coverage.h"
+#include "paths.h"
+#include "results.h"
+
 /**
  * @namespace SpiceQL types
  * 
@@ -123,12 +135,14 @@ namespace SpiceQL {
        *
        * Load a kernel into memory by opening the kernel and furnishing.
        * This also increases the reference count of the kernel. If the kernel
-       * has alrady been furnished, it is refurnshed.  
+       * has alrady been furnished, it is only refurnished when priority is set.
        *
        * @param path path to a kernel.
+       * @param priority if true, move an already furnished kernel ahead of every other
+       *                 loaded kernel, see KernelPool::load
        *
       **/
-      Kernel(std::string path);
+      Kernel(KernelPath path, bool priority=false);
 
 
       /**
@@ -152,7 +166,7 @@ namespace SpiceQL {
       ~Kernel();
 
       /*! path to the kernel */
-      std::string path; 
+      KernelPath path; 
       /*! type of kernel */
       Type type; 
       /*! quality of the kernel */
@@ -180,11 +194,179 @@ namespace SpiceQL {
   typedef std::unique_ptr<Kernel> StackKernel;
 
 
+  /**
+   * @brief A single segment summary (descriptor) from a DAF
+   */
+  struct DafSummary {
+    //! double precision components, for SPKs and CKs these are the start and stop time of the segment
+    std::vector<double> doubles;
+    //! integer components, for SPKs and CKs the first is the NAIF code of the body, the last two are
+    //! the segment's begin and end addresses
+    std::vector<int> ints;
+  };
+
+
+  /**
+   * @brief Read only, memory mapped binary kernel
+   *
+   * Alternative to Kernel for reading binary SPKs and CKs (DAFs) directly, without
+   * furnishing them. The file is mapped read only and shared, so every process reading
+   * the same kernel uses the same pages in the page cache and nothing is copied until
+   * it is read.
+   *
+   * The file record and segment summaries are parsed following NAIF's DAF Required
+   * Reading. Segment data can be read without copying when the kernel was written
+   * with this machine's byte order.
+   */
+  class MappedKernel {
+    public:
+
+    /**
+     * @brief Map a DAF into memory and read its file record
+     *
+     * @param path path to the DAF
+     * @throws std::invalid_argument if the file isn't a DAF in IEEE format
+     * @throws std::runtime_error if the file can't be mapped or is truncated
+     */
+    explicit MappedKernel(std::string path);
+
+
+    /**
+     * @brief Unmap the kernel
+     */
+    ~MappedKernel();
+
+    MappedKernel(MappedKernel const &other) = delete;
+    void operator=(MappedKernel const &other) = delete;
+
+
+    /**
+     * @brief Get the kernel type from the ID word (SPK, CK, PCK)
+     *
+     * @return std::string upper case kernel type
+     */
+    std::string getKernelType() const;
+
+
+    /**
+     * @brief Get the number of double precision components in each summary
+     *
+     * @return int ND from the file record
+     */
+    int getND() const;
+
+
+    /**
+     * @brief Get the number of integer components in each summary
+     *
+     * @return int NI from the file record
+     */
+    int getNI() const;
+
+
+    /**
+     * @brief Check whether the kernel was written with this machine's byte order
+     *
+     * @return true if getData can be used
+     */
+    bool isNativeByteOrder() const;
+
+
+    /**
+     * @brief Read every segment summary in the kernel, in file order
+     *
+     * @return std::vector<DafSummary> the summaries
+     */
+    std::vector<DafSummary> getSummaries() const;
+
+
+    /**
+     * @brief Get a view of the doubles between two DAF addresses without copying
+     *
+     * Addresses are 1-based double precision word addresses, like the begin and end
+     * addresses in a segment summary. The view is valid as long as the kernel is.
+     *
+     * @param begin address of the first double
+     * @param end address of the last double, inclusive
+     * @return std::span<const double> view of the mapped data
+     * @throws std::logic_error if the kernel isn't in the native byte order, use readData instead
+     */
+    std::span<const double> getData(int begin, int end) const;
+
+
+    /**
+     * @brief Copy the doubles between two DAF addresses, swapping bytes if needed
+     *
+     * @param begin address of the first double
+     * @param end address of the last double, inclusive
+     * @return std::vector<double> the data
+     */
+    std::vector<double> readData(int begin, int end) const;
+
+    //! path to the kernel
+    std::string path;
+
+    private:
+
+    /**
+     * @brief Read a double at a byte offset, swapping bytes if needed
+     */
+    double readDouble(std::size_t offset) const;
+
+
+    /**
+     * @brief Read a 32 bit integer at a byte offset, swapping bytes if needed
+     */
+    std::int32_t readInt(std::size_t offset) const;
+
+
+    /**
+     * @brief Check that [begin, end] is a valid range of addresses
+     */
+    void checkAddresses(int begin, int end) const;
+
+    //! start of the mapped file
+    unsigned char *data = nullptr;
+    //! size of the mapped file in bytes
+    std::size_t size = 0;
+    //! true if the file's byte order doesn't match this machine's
+    bool swap = false;
+    //! ID word from the file record, e.g. "DAF/SPK"
+    std::string idWord;
+    //! number of double precision components in a summary
+    int nd = 0;
+    //! number of integer components in a summary
+    int ni = 0;
+    //! record number of the first summary record
+    int fward = 0;
+  };
+
+
+  /**
+   * @brief Kernel pool cache statistics
+   */
+  struct KernelPoolStats {
+    //! loads of a kernel that was already furnished, either referenced or retained
+    size_t hits = 0;
+    //! loads of a kernel that had to be furnished
+    size_t misses = 0;
+    //! retained kernels unloaded to stay within the capacity
+    size_t evictions = 0;
+  };
+
+
   /**
    * @brief Singleton class for interacting with the cspice kernel pool 
    * 
    * Contains functions required to load and unload kernels and 
    * keep track of furnished kernels. 
+   *
+   * With a capacity set, kernels whose reference count drops to 0 stay furnished
+   * so they don't need to be reopened if they're loaded again soon. Once more than
+   * capacity kernels are retained, the least recently released ones are unloaded.
+   * The capacity defaults to $SSPICE_KERNEL_CAPACITY, or 0 which unloads kernels as
+   * soon as they aren't referenced. A value that isn't a non-negative integer is
+   * ignored with a warning.
    */
   class KernelPool {
     public:
@@ -213,7 +395,7 @@ namespace SpiceQL {
      * @param key key for the kernel to get the ref count for, usually the complete file path
      * @return unsigned int The number of references to the input kernel. If key doesn't exist, this is 0. 
      */
-    unsigned int getRefCount(std::string key);
+    unsigned int getRefCount(KernelPath key);
 
 
     /**
@@ -239,24 +421,39 @@ namespace SpiceQL {
      * @brief load kernel into the kernel pool 
      * 
      * This should be called for furnshing kernel instead of furnsh_c directly 
-     * so that they are tracked throughout the process. 
+     * so that they are tracked throughout the process. Only the first load
+     * of a kernel furnishes it, later loads only increase the reference count.
      *
      * @param kernelPath Path to the kernel to load 
-     * @param force_refurnsh If true, call furnsh on the kernel even if the kernel is already in the pool. Default is True. 
+     * @param force_refurnsh If true and the kernel is already in the pool, unload and furnish it
+     *                       again so it takes precedence over every other loaded kernel. Default is False.
+     * @return int the kernel's reference count
      */
-    int load(std::string kernelPath, bool force_refurnsh=true);
+    int load(KernelPath kernelPath, bool force_refurnsh=false);
 
 
     /**
      * @brief reduce the reference count for a kernel 
      * 
      * This reduces the ref count by one, and if the ref count hits 0, 
-     * the kernel is unfurnished. Use this instead of calling unload_c 
+     * the kernel is unfurnished (or retained, see setCapacity). Use this instead of calling unload_c 
      * directly as you cause errors from desyncs. 
      * 
      * @param kernelPath path to the kernel
      */
-    int unload(std::string kernelPath);    
+    int unload(KernelPath kernelPath);    
+
+
+    /**
+     * @brief Get where a kernel is in CSPICE's load order
+     *
+     * Kernels with a higher priority were furnished later and take precedence
+     * over kernels with a lower one.
+     *
+     * @param kernelPath path to the kernel
+     * @return unsigned long the kernel's priority, 0 if it isn't furnished
+     */
+    unsigned long getPriority(KernelPath kernelPath);
 
 
     /**
@@ -266,6 +463,70 @@ namespace SpiceQL {
      */
     void loadClockKernels();
 
+
+    /**
+     * @brief Set the number of unreferenced kernels to keep furnished
+     *
+     * Retained kernels over the new capacity are unloaded.
+     *
+     * @param capacity max number of retained kernels, 0 to unload kernels as soon
+     *                 as their reference count hits 0
+     */
+    void setCapacity(size_t capacity);
+
+
+    /**
+     * @brief Get the number of unreferenced kernels kept furnished
+     *
+     * @return size_t max number of retained kernels
+     */
+    size_t getCapacity();
+
+
+    /**
+     * @brief Get the kernels that are furnished but not referenced
+     *
+     * A retained kernel that's loaded again is reused without calling furnsh, so it
+     * keeps the priority it had in CSPICE when it was first loaded.
+     *
+     * @return std::vector<std::string> retained kernels, most recently released first
+     */
+    std::vector<std::string> getRetainedKernels();
+
+
+    /**
+     * @brief Get the hit, miss and eviction counts since the last reset
+     *
+     * @return KernelPoolStats cache statistics
+     */
+    KernelPoolStats getStats();
+
+
+    /**
+     * @brief Reset the hit, miss and eviction counts to 0
+     */
+    void resetStats();
+
+
+    /**
+     * @brief Get every furnished kernel, referenced or retained, in the order CSPICE loaded them
+     *
+     * Loading the kernels in this order gives them the same precedence they have now.
+     *
+     * @return std::vector<std::string> furnished kernels, lowest priority first
+     */
+    std::vector<std::string> getFurnishedKernels();
+
+
+    /**
+     * @brief Forget every kernel without unloading it
+     *
+     * Reference counts, retained kernels and priorities are reset. Only for processes
+     * that cleared CSPICE's pool themselves, e.g. a forked worker after kclear_c,
+     * so the next load of a kernel furnishes it again.
+     */
+    void clear();
+
     private: 
 
     /**
@@ -283,7 +544,33 @@ namespace SpiceQL {
     ~KernelPool() = default;
     
     //! map for tracking what kernels have been furnished and how often. 
-    std::unordered_map<std::string, int> refCounts;
+    std::unordered_map<KernelPath, int> refCounts;
+
+    /**
+     * @brief Unload retained kernels until no more than capacity are left, lock must be held
+     */
+    void evict(size_t capacity);
+
+    //! max number of unreferenced kernels kept furnished
+    size_t capacity = 0;
+
+    //! furnished kernels with no references, most recently released first
+    std::list<KernelPath> retained;
+
+    //! position of each retained kernel in retained
+    std::unordered_map<KernelPath, std::list<KernelPath>::iterator> retainedIndex;
+
+    KernelPoolStats stats;
+
+    //! priority of every furnished kernel, referenced or retained
+    std::unordered_map<KernelPath, unsigned long> priorities;
+
+    //! priority given to the next kernel that's furnished
+    unsigned long nextPriority = 1;
+
+    //! guards refCounts and keeps it in sync with the CSPICE pool when kernels are loaded from many threads.
+    //! CSPICE itself isn't thread safe, use SpiceWorker to run queries from many threads.
+    std::mutex lock;
 
   };
 
@@ -296,6 +583,9 @@ namespace SpiceQL {
    * goes out of scope. 
    *
    * Generally used on results from a kernel query. 
+   *
+   * In lazy mode, SPKs and CKs are only furnished once a time range they cover is
+   * requested with load, every other kernel is furnished right away.
    */
   class KernelSet {
     public:
@@ -303,27 +593,220 @@ namespace SpiceQL {
     /**
      * @brief Construct a new Kernel Set object
      * 
+     * Kernels take precedence in the order they appear in the json. A kernel that's
+     * already furnished is only refurnished if it was loaded before a kernel that comes
+     * earlier in the set.
+     *
      * @param kernels 
+     * @param lazy if true, SPKs and CKs aren't furnished until load is called. Their
+     *             coverage comes from the CoverageCache, so they're only opened the
+     *             first time they're seen
      */
-    KernelSet(nlohmann::json kernels);
+    KernelSet(nlohmann::json kernels, bool lazy=false);
+
+
+    /**
+     * @brief Construct a new Kernel Set object from typed query results
+     *
+     * Same as KernelSet(nlohmann::json, bool) with the json from KernelQueryResult::toJson,
+     * without searching the json for the kernel lists.
+     *
+     * @param kernels kernels to furnish
+     * @param lazy if true, SPKs and CKs aren't furnished until load is called
+     */
+    KernelSet(KernelQueryResult const &kernels, bool lazy=false);
     ~KernelSet() = default;
 
+
+    /**
+     * @brief Furnish the lazy kernels covering a time range
+     *
+     * Lazy kernels that don't cover the range are unloaded. Kernels are always furnished
+     * in the order they appear in the json, so CSPICE's priority is the same as if the
+     * set was loaded eagerly. Does nothing if the set isn't lazy.
+     *
+     * @param start start of the time range
+     * @param stop end of the time range
+     */
+    void load(double start, double stop);
+
+
+    /**
+     * @brief Furnish the lazy kernels covering any of a list of times
+     *
+     * @param times times that will be queried
+     * @see load(double, double)
+     */
+    void load(std::vector<double> const &times);
+
+
+    /**
+     * @brief Get the lazy kernels that are currently furnished
+     *
+     * @return std::vector<std::string> paths in load order
+     */
+    std::vector<std::string> getLazyLoadedKernels() const;
+
     //! map of path to kernel pointers
     std::unordered_map<std::string, std::vector<SharedKernel>> loadedKernels;
     
     //! json used to populate the loadedKernels
     nlohmann::json kernels; 
+
+    private:
+
+    /**
+     * @brief Furnish the kernel lists, used by the constructors
+     *
+     * @param lists json pointer to each "kernels" key and its kernels, in json order
+     * @param lazy if true, SPKs and CKs are added to the lazy index instead of being furnished
+     */
+    void loadLists(std::vector<std::pair<std::string, std::vector<KernelPath>>> const &lists, bool lazy);
+
+
+    /**
+     * @brief Furnish the lazy kernels returned from a coverage query
+     */
+    void loadLazy(std::vector<KernelPath> const &needed);
+
+    //! coverage of the lazy kernels, in json order
+    CoverageIndex lazyIndex;
+
+    //! furnished lazy kernels, same order as lazyIndex.getKernels(), null if not loaded
+    std::vector<SharedKernel> lazyKernels;
+  };
+
+
+  /**
+   * @brief Singleton for converting between UTC and ephemeris times
+   *
+   * The LSK is looked up in the data directory and furnished on the first conversion,
+   * then kept loaded for every later one. It's looked up again if $SPICEROOT,
+   * $ALESPICEROOT or $ISISDATA change.
+   */
+  class TimeConverter {
+    public:
+
+    /**
+     * Delete constructors and such as this is a singleton
+     */
+    TimeConverter(TimeConverter const &other) = delete;
+    void operator=(TimeConverter const &other) = delete;
+
+
+    /**
+     * @brief Get the converter instance
+     *
+     * @return TimeConverter&
+     */
+    static TimeConverter &getInstance();
+
+
+    /**
+     * @brief convert a UTC string to an ephemeris time
+     *
+     * @param utc UTC string, e.g. "1988 June 13, 12:29:48 TDB"
+     * @return double ephemeris time
+     */
+    double utcToEt(std::string const &utc);
+
+
+    /**
+     * @brief convert many UTC strings to ephemeris times
+     *
+     * @param utcs UTC strings
+     * @return std::vector<double> ephemeris times, same order as utcs
+     */
+    std::vector<double> utcToEt(std::vector<std::string> const &utcs);
+
+
+    /**
+     * @brief convert an ephemeris time to a UTC string
+     *
+     * See Also: https://naif.jpl.nasa.gov/pub/naif/toolkit_docs/C/cspice/et2utc_c.html
+     *
+     * @param et ephemeris time
+     * @param format et2utc format, one of "C", "D", "J", "ISOC" or "ISOD"
+     * @param precision number of decimal places for the seconds
+     * @return std::string UTC string
+     */
+    std::string etToUtc(double et, std::string const &format="ISOC", int precision=6);
+
+
+    /**
+     * @brief convert many ephemeris times to UTC strings
+     *
+     * @see etToUtc(double, std::string const &, int)
+     */
+    std::vector<std::string> etToUtc(std::vector<double> const &ets, std::string const &format="ISOC", int precision=6);
+
+
+    /**
+     * @brief Get the path of the LSK used for conversions, furnishing it if needed
+     *
+     * @return std::string path to the LSK
+     */
+    std::string getLsk();
+
+
+    /**
+     * @brief Unload the LSK, the next conversion looks it up again
+     */
+    void release();
+
+    private:
+
+    //! Constructor, the KernelPool is created first so it outlives the pinned LSK
+    TimeConverter();
+
+
+    /**
+     * @brief Look up and furnish the LSK if it hasn't been or the data directory changed
+     */
+    void pin();
+
+    //! the pinned LSK
+    std::unique_ptr<Kernel> lsk;
+
+    //! data directory environment the LSK was found with
+    std::string environment;
+
+    std::mutex lock;
   };
 
 
   /**
    * @brief convert a UTC string to an ephemeris time
    *
-   * Basically a wrapper around NAIF's cspice str2et function except it also temporarily loads the required kernels.
-   * See Also: https://naif.jpl.nasa.gov/pub/naif/toolkit_docs/C/cspice/str2et_c.html
+   * Basically a wrapper around NAIF's cspice utc2et function using the TimeConverter's LSK.
+   * See Also: https://naif.jpl.nasa.gov/pub/naif/toolkit_docs/C/cspice/utc2et_c.html
    *
    * @param et UTC string, e.g. "1988 June 13, 12:29:48 TDB"
    * @returns double precision ephemeris time
    **/
   double utcToEt(std::string et);
+
+
+  /**
+   * @brief convert many UTC strings to ephemeris times
+   *
+   * @see TimeConverter::utcToEt(std::vector<std::string> const &)
+   */
+  std::vector<double> utcToEt(std::vector<std::string> const &utcs);
+
+
+  /**
+   * @brief convert an ephemeris time to a UTC string
+   *
+   * @see TimeConverter::etToUtc(double, std::string const &, int)
+   */
+  std::string etToUtc(double et, std::string const &format="ISOC", int precision=6);
+
+
+  /**
+   * @brief convert many ephemeris times to UTC strings
+   *
+   * @see TimeConverter::etToUtc(double, std::string const &, int)
+   */
+  std::vector<std::string> etToUtc(std::vector<double> const &ets, std::string const &format="ISOC", int precision=6);
 }
@@ -10,4 +10,12 @@
 #include "utils.h"
 #include "kernel.h"
 #include "io.h"
-#include "query.h"
\ No newline at end of file
+#include "query.h"
+#include "inventory.h"
+#include "coverage.h"
+#include "daf.h"
+#include "ephemeris.h"
+#include "worker.h"
+#include "config.h"
+#include "results.h"
+#include "paths.h"
\ No newline at end of file
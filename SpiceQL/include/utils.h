@@ -5,9 +5,14 @@
  **/
 #pragma once
 
+#include <functional>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <regex>
 #include <optional>
+#include <span>
+#include <unordered_map>
 
 #include <fmt/chrono.h>
 #include <fmt/format.h>
@@ -55,7 +60,8 @@ namespace SpiceQL {
   /**
     * @brief ls, like in unix, kinda. Also it's a function.
     *
-    * Iterates the input path and returning a list of files. Optionally, recursively.
+    * Iterates the input path and returning a sorted list of files. Optionally, recursively.
+    * Recursive listings are done in parallel using walk.
     *
     * @param root The root directory to search
     * @param recursive recursively iterates through directories if true
@@ -65,6 +71,30 @@ namespace SpiceQL {
   std::vector<std::string> ls(std::string const & root, bool recursive);
 
 
+  /**
+    * @brief Walk a directory tree in parallel, streaming paths as they are found
+    *
+    * Subdirectories are fanned out across a pool of threads, each with its own queue.
+    * Threads that run out of directories steal from the others, and sleep until more are
+    * queued if there's nothing to steal. The root is listed before any threads are started,
+    * so a directory without subdirectories is walked serially. Paths are handed to the
+    * callback in batches, calls to the callback are serialized so it doesn't need to
+    * be thread safe. The order of the paths is unspecified.
+    *
+    * Like ls, directories are included in the output, symlinks to directories are
+    * listed but not followed and broken symlinks are skipped.
+    *
+    * @param root The root directory to walk
+    * @param callback function called with each batch of paths
+    * @param recursive recursively walks through directories if true
+    * @param nthreads number of threads to use, 0 uses the number of hardware threads up to 8
+   **/
+  void walk(std::string const & root,
+            std::function<void(std::vector<std::string> &)> const & callback,
+            bool recursive=true,
+            unsigned int nthreads=0);
+
+
   /**
     * @brief glob, like python's glob.glob, except C++
     *
@@ -81,6 +111,96 @@ namespace SpiceQL {
                              bool recursive=false);
 
 
+  /**
+    * @brief glob, but over an existing listing of files
+    *
+    * Given a list of paths and a regular expression, give all the paths that match.
+    * Use this instead of glob(std::string const &, std::regex const &, bool) to avoid
+    * walking the same directory more than once.
+    *
+    * @param paths list of paths to search, usually from ls
+    * @param reg std::regex object to pattern to search
+    *
+    * @returns list of paths matching regex
+   **/
+  std::vector<std::string> glob(std::vector<std::string> const & paths,
+                             std::regex const & reg);
+
+
+  /**
+   * @brief Groups of regular expressions compiled once and matched in a single pass
+   *
+   * Each group is a list of regular expressions, a path matches a group if it
+   * matches any expression in the group, the same as joining them with "|". Every
+   * unique expression is compiled once and a literal substring required by the
+   * expression is used to skip the regex search for most paths.
+   *
+   * Sets are usually acquired through PatternSet::get which caches them by their patterns
+   * so the kernel regexes in the mission configs are only compiled once per process.
+   */
+  class PatternSet {
+    public:
+
+    /**
+     * @brief Compile the groups of regular expressions
+     *
+     * @param groups list of groups of regular expressions
+     */
+    explicit PatternSet(std::vector<std::vector<std::string>> const &groups);
+
+
+    /**
+     * @brief Get a compiled PatternSet from the process wide cache
+     *
+     * @param groups list of groups of regular expressions
+     * @return std::shared_ptr<const PatternSet> the compiled set
+     */
+    static std::shared_ptr<const PatternSet> get(std::vector<std::vector<std::string>> const &groups);
+
+
+    /**
+     * @brief Get the groups a path matches
+     *
+     * @param path path to match
+     * @param filenameOnly if true, only the part of the path after the last '/' is matched
+     * @return std::vector<size_t> indices of the matching groups in ascending order
+     */
+    std::vector<size_t> match(std::string const &path, bool filenameOnly=false) const;
+
+
+    /**
+     * @brief glob every group in a single pass over the paths
+     *
+     * @param paths list of paths to search, usually from ls
+     * @param filenameOnly if true, only the part of each path after the last '/' is matched
+     * @return std::vector<std::vector<std::string>> the paths matching each group, in the order of the input paths
+     */
+    std::vector<std::vector<std::string>> glob(std::vector<std::string> const &paths, bool filenameOnly=false) const;
+
+
+    /**
+     * @brief Get the longest literal substring a path must contain to match a regular expression
+     *
+     * Only handles simple expressions, an empty string is returned for anything with
+     * alternations or subexpressions.
+     *
+     * @param pattern ECMAScript regular expression
+     * @return std::string required substring, empty if none could be found
+     */
+    static std::string requiredLiteral(std::string const &pattern);
+
+    private:
+    //! number of groups
+    size_t ngroups;
+    //! every unique expression, compiled
+    std::vector<std::regex> regexes;
+    //! literal each path must contain to match the regex at the same index
+    std::vector<std::string> literals;
+    //! groups each regex belongs to
+    std::vector<std::vector<size_t>> regexGroups;
+  };
+
+
   /**
     * @brief Get start and stop times a kernel.
     *
@@ -88,6 +208,8 @@ namespace SpiceQL {
     * This gets all start and stop times regardless of the frame associated with it.
     *
     * Input kernel is assumed to be a binary kernel with time dependant external orientation data.
+    * Only spacecraft and instrument bodies (negative NAIF codes) are included. The coverage
+    * is looked up in the CoverageCache, so the kernel is only opened the first time.
     *
     * @param kpath Path to the kernel
     * @returns std::vector of start and stop times
@@ -95,6 +217,20 @@ namespace SpiceQL {
   std::vector<std::pair<double, double>> getTimeIntervals(std::string kpath);
 
 
+  /**
+    * @brief Get start and stop times of every body in a kernel.
+    *
+    * Reads the coverage of each body straight from the kernel's segment summaries, only
+    * furnishing the kernel for DAFs readDafCoverage can't read. Prefer getTimeIntervals
+    * or CoverageCache::getCoverage, which don't reopen kernels whose coverage is already known.
+    *
+    * @param kpath Path to the binary kernel
+    * @param convertSclk if false, CK times are left as encoded SCLK instead of converted to ET
+    * @returns map of NAIF body code to start and stop times
+   **/
+  std::map<int, std::vector<std::pair<double, double>>> getBodyIntervals(std::string kpath, bool convertSclk = true);
+
+
   /**
    * @brief Simple struct for holding target states
    */
@@ -129,6 +265,50 @@ namespace SpiceQL {
   targetState getTargetState(double et, std::string target, std::string observer, std::string frame="J2000", std::string abcorr="NONE");
 
 
+  /**
+   * @brief Positions, velocities and light times for many epochs, stored as a structure of arrays
+   *
+   * All values are in a single buffer, one contiguous block of n values per component.
+   */
+  struct targetStates {
+    //! components stored in data, in order
+    enum Component {X=0, Y, Z, VX, VY, VZ, LT};
+
+    //! number of epochs
+    size_t n = 0;
+
+    //! 7*n values, x, y, z, vx, vy, vz and then light time blocks
+    std::vector<double> data;
+
+    /**
+     * @brief Get a contiguous view of a single component
+     *
+     * @param c component to get
+     * @return std::span<const double> n values for the component
+     */
+    std::span<const double> component(Component c) const {
+      return std::span<const double>(data.data() + c * n, n);
+    }
+  };
+
+
+  /**
+   * @brief Gives the position and velocity for a given frame at many ephemeris times
+   *
+   * Batch version of getTargetState. The target and observer are resolved to NAIF
+   * codes once and spkez_c is called for each time.
+   *
+   * @param ets ephemeris times at which you want to optain the target state
+   * @param target NAIF name or ID for the target
+   * @param observer NAIF name or ID for the observer
+   * @param frame The reference frame in which to get the positions in
+   * @param abcorr aborration correction flag, default it NONE. See getTargetState
+   * @return targetStates with the states and light times for every time
+   * @throws std::invalid_argument if the target, observer or frame is unknown
+  **/
+  targetStates getTargetStates(std::span<const double> ets, std::string target, std::string observer, std::string frame="J2000", std::string abcorr="NONE");
+
+
   /**
    * @brief simple struct for holding target orientations
    */
@@ -151,6 +331,29 @@ namespace SpiceQL {
   targetOrientation getTargetOrientation(double et, int toframe, int refframe=1); // use j2000 for default reference frame
 
 
+  /**
+   * @brief Gives quaternions and angular velocities for a given frame at many ephemeris times
+   *
+   * Batch version of getTargetOrientation that writes into caller provided buffers
+   * instead of returning a targetOrientation per time. Row i of each buffer holds
+   * the orientation at ets[i].
+   *
+   * If the angular velocity can't be computed at a time, the rotation is computed
+   * without it and that row of avs is set to NaN.
+   *
+   * @param ets ephemeris times at which you want to optain the target pointing
+   * @param toframe the source frame's NAIF code.
+   * @param refframe the reference frame's NAIF code, orientations are relative to this reference frame
+   * @param quats output buffer for Nx4 SPICE-style quaternions (w,x,y,z), row major
+   * @param avs output buffer for Nx3 angular velocities, row major. If empty, angular
+   *            velocities aren't computed
+   * @returns number of times where the angular velocity couldn't be computed, 0 if avs is empty
+   * @throws std::invalid_argument if the buffers are too small
+  **/
+  size_t getTargetOrientations(std::span<const double> ets, int toframe, int refframe,
+                               std::span<double> quats, std::span<double> avs);
+
+
   /**
     * @brief finds key:values in kernel pool
     *
@@ -168,6 +371,7 @@ namespace SpiceQL {
     * @brief recursively search keys in json.
     *
     * Given a root and a regular expression, give all the files that match.
+    * Matches inside a value come before the value's own key.
     *
     * @param in input json to search
     * @param key key to search for
@@ -175,12 +379,72 @@ namespace SpiceQL {
     *
     * @returns vector of refernces to matching json objects
    **/
-  std::vector<nlohmann::json::json_pointer> findKeyInJson(nlohmann::json in, std::string key, bool recursive=true);
+  std::vector<nlohmann::json::json_pointer> findKeyInJson(nlohmann::json const &in, std::string const &key, bool recursive=true);
+
+
+  /**
+    * @brief Call a function on every value with a given key, without copying the json
+    *
+    * Values are visited in the same order findKeyInJson returns them.
+    *
+    * @param in input json to search
+    * @param key key to search for
+    * @param visitor called with the pointer to and the value of each match
+    * @param recursive recursively iterates through objects if true
+   **/
+  void visitKeyInJson(nlohmann::json const &in, std::string const &key,
+                      std::function<void(nlohmann::json::json_pointer const &, nlohmann::json const &)> const &visitor,
+                      bool recursive=true);
+
+
+  /**
+   * @brief Index of every key in a json document
+   *
+   * Built with a single walk of the document, after that looking up a key doesn't
+   * touch the document. Use this instead of findKeyInJson when searching the same
+   * document for many keys. The index has to be rebuilt if keys are added to or
+   * removed from the document, changing the values of existing keys is fine.
+   */
+  class JsonKeyIndex {
+    public:
+
+    /**
+     * @brief Index a document
+     *
+     * @param in json to index
+     */
+    explicit JsonKeyIndex(nlohmann::json const &in);
+
+
+    /**
+     * @brief Get the pointers to every value with a key
+     *
+     * @param key key to search for
+     * @return pointers in the same order as findKeyInJson(in, key, true), empty if there are none
+     */
+    std::vector<nlohmann::json::json_pointer> const &find(std::string const &key) const;
+
+
+    /**
+     * @brief Check if the document has a key anywhere
+     *
+     * @param key key to search for
+     * @return true if at least one value has the key
+     */
+    bool contains(std::string const &key) const;
+
+    private:
+
+    //! map of key to the pointers of the values with that key
+    std::unordered_map<std::string, std::vector<nlohmann::json::json_pointer>> index;
+  };
 
 
   /**
     * @brief get the Kernel type (CK, SPK, etc.)
     *
+    * The type is read from the kernel's ID word, kernels are only furnished when
+    * they don't have one.
     *
     * @param kernelPath path to kernel
     * @returns Kernel type as a string
@@ -0,0 +1,273 @@
+#pragma once
+/**
+  * @file
+  *
+  * Concurrency around CSPICE. CSPICE keeps its kernel pool and error state in
+  * globals, so calls from more than one thread at a time aren't safe. SpiceWorker
+  * runs work from many threads on a single thread, WorkerPool spreads work across
+  * processes that each have their own CSPICE state.
+  *
+ **/
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <sys/types.h>
+
+#include <nlohmann/json.hpp>
+
+#include "utils.h"
+
+namespace SpiceQL {
+
+  /**
+   * @brief Singleton thread that runs every task that calls into CSPICE
+   *
+   * Any thread can submit a task and get a future for its result. Tasks are pushed
+   * onto a lock free multi producer, single consumer queue and run one at a time,
+   * in the order they were submitted, on the worker thread. Exceptions thrown by a
+   * task are rethrown from the future's get().
+   *
+   * Kernels should be loaded and unloaded from inside tasks so that the CSPICE pool
+   * is only touched by the worker thread:
+   *
+   * @code
+   *   std::future<targetState> state = SpiceWorker::getInstance().submit([=]() {
+   *     KernelSet kernels(query);
+   *     return getTargetState(et, "LRO", "MOON");
+   *   });
+   * @endcode
+   */
+  class SpiceWorker {
+    public:
+
+    /**
+     * Delete constructors and such as this is a singleton
+     */
+    SpiceWorker(SpiceWorker const &other) = delete;
+    void operator=(SpiceWorker const &other) = delete;
+
+
+    /**
+     * @brief Get the worker, starting its thread on the first call
+     *
+     * @return SpiceWorker&
+     */
+    static SpiceWorker &getInstance();
+
+
+    /**
+     * @brief Queue a task to run on the worker thread
+     *
+     * Tasks submitted from the worker thread, e.g. from inside another task, run
+     * immediately instead of waiting behind the task that submitted them.
+     *
+     * @param task callable taking no arguments
+     * @return std::future for the task's result
+     */
+    template <typename F>
+    std::future<std::invoke_result_t<F>> submit(F &&task) {
+      using R = std::invoke_result_t<F>;
+
+      auto packaged = std::make_shared<std::packaged_task<R()>>(std::forward<F>(task));
+      std::future<R> res = packaged->get_future();
+
+      if (std::this_thread::get_id() == thread.get_id()) {
+        (*packaged)();
+      }
+      else {
+        push(new Node{[packaged]() { (*packaged)(); }, {nullptr}});
+      }
+      return res;
+    }
+
+
+    /**
+     * @brief Get the number of tasks that have been submitted but not finished
+     *
+     * @return size_t number of queued or running tasks
+     */
+    size_t pending() const;
+
+    private:
+
+    //! Queue node, owned by the queue from push until it's run
+    struct Node {
+      std::function<void()> task;
+      std::atomic<Node *> next;
+    };
+
+    //! Starts the worker thread
+    SpiceWorker();
+
+    //! Runs the remaining tasks and stops the worker thread
+    ~SpiceWorker();
+
+
+    /**
+     * @brief Add a node to the queue, safe to call from any thread
+     */
+    void push(Node *node);
+
+
+    /**
+     * @brief Take the oldest node off of the queue, only called from the worker thread
+     *
+     * @return the node, or nullptr if the queue is empty or a push hasn't finished
+     */
+    Node *pop();
+
+
+    /**
+     * @brief Worker thread loop
+     */
+    void run();
+
+    //! most recently pushed node, producers swap themselves in here
+    std::atomic<Node *> head;
+
+    //! oldest node, only used by the worker thread
+    Node *tail;
+
+    //! placeholder that keeps the queue from ever being empty
+    Node stub;
+
+    //! bumped after every push, the worker waits on it when there's nothing to do
+    std::atomic<std::uint64_t> signal = 0;
+
+    //! submitted tasks that haven't finished
+    std::atomic<size_t> count = 0;
+
+    std::atomic<bool> stopping = false;
+
+    std::thread thread;
+  };
+
+
+  /**
+   * @brief Pool of forked worker processes for parallel CSPICE work
+   *
+   * Every worker clears the CSPICE pool it inherited, furnishes the kernels that
+   * were loaded in the parent when the pool was created plus the pool's KernelSet,
+   * and then waits for work. Batched calls are split into one chunk per worker and
+   * run in parallel. Times and results are passed through a shared memory arena per
+   * worker, commands and small results go over a socket.
+   *
+   * Create the pool before starting other threads, e.g. the SpiceWorker, as only the
+   * calling thread is copied into the workers. Calls on the pool are serialized, use
+   * the batched functions to keep the workers busy.
+   *
+   * Workers aren't restarted, if one dies (e.g. on a CSPICE error) the call that was
+   * using it throws std::runtime_error.
+   */
+  class WorkerPool {
+    public:
+
+    /**
+     * @brief Fork the workers
+     *
+     * @param kernels kernel query result to furnish in every worker, as used by KernelSet
+     * @param nworkers number of worker processes, 0 for one per core
+     * @param arenaBytes size of each worker's shared memory arena, larger batches are split
+     *                   into more rounds
+     * @throws std::runtime_error if the workers can't be started
+     */
+    WorkerPool(nlohmann::json kernels, unsigned nworkers=0, size_t arenaBytes=64<<20);
+
+
+    /**
+     * @brief Stop the workers and wait for them to exit
+     */
+    ~WorkerPool();
+
+    WorkerPool(WorkerPool const &other) = delete;
+    void operator=(WorkerPool const &other) = delete;
+
+
+    /**
+     * @brief Parallel version of getTargetStates
+     *
+     * @see getTargetStates
+     */
+    targetStates getTargetStates(std::span<const double> ets, std::string target, std::string observer,
+                                 std::string frame="J2000", std::string abcorr="NONE");
+
+
+    /**
+     * @brief Parallel version of getTargetOrientations
+     *
+     * @see getTargetOrientations
+     */
+    size_t getTargetOrientations(std::span<const double> ets, int toFrame, int refFrame,
+                                 std::span<double> quats, std::span<double> avs);
+
+
+    /**
+     * @brief Get the time intervals of many kernels in parallel
+     *
+     * @param kernels paths to binary kernels
+     * @return time intervals for each kernel, in the same order, see getTimeIntervals
+     */
+    std::vector<std::vector<std::pair<double, double>>> getTimeIntervals(std::vector<std::string> const &kernels);
+
+
+    /**
+     * @brief Get the number of workers
+     *
+     * @return size_t number of worker processes
+     */
+    size_t size() const;
+
+    private:
+
+    //! A forked worker process
+    struct Worker {
+      pid_t pid;
+      //! socket to the worker
+      int fd;
+      //! shared memory for inputs and outputs
+      double *arena;
+    };
+
+
+    /**
+     * @brief Split n items across the workers and run them
+     *
+     * Each round sends a command to every worker with some of the items and then
+     * waits for all of them to reply.
+     *
+     * @param n number of items
+     * @param doublesPerItem arena space needed for each item's inputs and outputs, 0 if the
+     *                       arena isn't used
+     * @param start writes a chunk's inputs to the worker's arena and returns the command
+     * @param finish reads a chunk's outputs from the worker's arena and reply
+     */
+    void run(size_t n, size_t doublesPerItem,
+             std::function<nlohmann::json(double *arena, size_t begin, size_t count)> start,
+             std::function<void(double *arena, nlohmann::json const &reply, size_t begin, size_t count)> finish);
+
+
+    /**
+     * @brief Tell the workers to quit, wait for them and release their arenas
+     */
+    void stop();
+
+    std::vector<Worker> workers;
+
+    //! number of doubles in each arena
+    size_t arenaDoubles;
+
+    //! only one batch uses the workers at a time
+    std::mutex lock;
+  };
+}
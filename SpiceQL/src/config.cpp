@@ -0,0 +1,172 @@
+/**
+  * @file
+  *
+  *
+ **/
+
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <regex>
+#include <unordered_map>
+
+#include <fmt/format.h>
+
+#include <ghc/fs_std.hpp>
+
+#include "config.h"
+#include "utils.h"
+
+using json = nlohmann::json;
+using namespace std;
+
+namespace SpiceQL {
+
+  struct ConfigRegistry::Snapshot {
+    //! environment the config directory was found with
+    string environment;
+    //! modification time of the config directory
+    int64_t directoryTime;
+    //! config file paths
+    vector<string> files;
+    //! modification time of each config file
+    vector<int64_t> fileTimes;
+    //! parsed configs, same order as files
+    vector<shared_ptr<const json>> configs;
+    //! map of config file name to index in files
+    unordered_map<string, size_t> index;
+  };
+
+
+  /**
+   * @brief Get the environment variables that pick the config directory
+   **/
+  static string configEnvironment() {
+    char *ptr = getenv("CONDA_PREFIX");
+    string env = ptr == NULL ? "" : ptr;
+    env += getenv("SSPICE_DEBUG") ? "\ndebug" : "\n";
+    return env;
+  }
+
+
+  /**
+   * @brief Get a file's modification time, or the minimum value if it can't be read
+   **/
+  static int64_t modifiedTime(string const &path) {
+    error_code ec;
+    fs::file_time_type mtime = fs::last_write_time(path, ec);
+    return ec ? numeric_limits<int64_t>::min() : static_cast<int64_t>(mtime.time_since_epoch().count());
+  }
+
+
+  ConfigRegistry &ConfigRegistry::getInstance() {
+    static ConfigRegistry registry;
+    return registry;
+  }
+
+
+  shared_ptr<const json> ConfigRegistry::getConfig(string const &mission) {
+    shared_ptr<const Snapshot> snapshot = get();
+
+    auto it = snapshot->index.find(fmt::format("{}.json", mission));
+    if (it == snapshot->index.end()) {
+      throw invalid_argument(fmt::format("Config file for \"{}\" not found", mission));
+    }
+    return snapshot->configs[it->second];
+  }
+
+
+  string ConfigRegistry::getConfigFile(string const &mission) {
+    shared_ptr<const Snapshot> snapshot = get();
+
+    auto it = snapshot->index.find(fmt::format("{}.json", mission));
+    if (it == snapshot->index.end()) {
+      throw invalid_argument(fmt::format("Config file for \"{}\" not found", mission));
+    }
+    return snapshot->files[it->second];
+  }
+
+
+  vector<shared_ptr<const json>> ConfigRegistry::getConfigs() {
+    return get()->configs;
+  }
+
+
+  vector<string> ConfigRegistry::getConfigFiles() {
+    return get()->files;
+  }
+
+
+  void ConfigRegistry::setAutoReload(bool autoReload) {
+    lock_guard<mutex> guard(lock);
+    this->autoReload = autoReload;
+  }
+
+
+  bool ConfigRegistry::getAutoReload() {
+    lock_guard<mutex> guard(lock);
+    return autoReload;
+  }
+
+
+  bool ConfigRegistry::reload() {
+    lock_guard<mutex> guard(lock);
+
+    if (current && !isStale(*current, true)) {
+      return false;
+    }
+    current = load();
+    return true;
+  }
+
+
+  shared_ptr<const ConfigRegistry::Snapshot> ConfigRegistry::get() {
+    lock_guard<mutex> guard(lock);
+
+    if (!current || isStale(*current, autoReload)) {
+      current = load();
+    }
+    return current;
+  }
+
+
+  shared_ptr<const ConfigRegistry::Snapshot> ConfigRegistry::load() {
+    shared_ptr<Snapshot> snapshot = make_shared<Snapshot>();
+    snapshot->environment = configEnvironment();
+
+    fs::path dbDir = getConfigDirectory();
+    snapshot->directoryTime = modifiedTime(dbDir);
+    snapshot->files = glob(dbDir, basic_regex("json"), false);
+
+    for (size_t i = 0; i < snapshot->files.size(); i++) {
+      string const &path = snapshot->files[i];
+      snapshot->fileTimes.emplace_back(modifiedTime(path));
+
+      ifstream ifs(path);
+      snapshot->configs.emplace_back(make_shared<const json>(json::parse(ifs)));
+      snapshot->index.emplace(fs::path(path).filename().string(), i);
+    }
+    return snapshot;
+  }
+
+
+  bool ConfigRegistry::isStale(Snapshot const &snapshot, bool checkFiles) {
+    if (snapshot.environment != configEnvironment()) {
+      return true;
+    }
+
+    if (checkFiles) {
+      // adding, removing or renaming a file changes the directory
+      if (modifiedTime(getConfigDirectory()) != snapshot.directoryTime) {
+        return true;
+      }
+
+      for (size_t i = 0; i < snapshot.files.size(); i++) {
+        if (modifiedTime(snapshot.files[i]) != snapshot.fileTimes[i]) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+}
@@ -0,0 +1,360 @@
+/**
+  * @file
+  *
+  *
+ **/
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+
+#include <ghc/fs_std.hpp>
+
+#include "coverage.h"
+#include "daf.h"
+#include "utils.h"
+
+using json = nlohmann::json;
+using namespace std;
+
+namespace SpiceQL {
+
+  /**
+   * @brief Get a file's size and modification time, used to detect changed kernels
+   **/
+  static optional<pair<uintmax_t, int64_t>> fileStamp(string const &path) {
+    error_code ec;
+    uintmax_t size = fs::file_size(path, ec);
+    if (ec) {
+      return nullopt;
+    }
+
+    fs::file_time_type mtime = fs::last_write_time(path, ec);
+    if (ec) {
+      return nullopt;
+    }
+    return make_pair(size, static_cast<int64_t>(mtime.time_since_epoch().count()));
+  }
+
+
+  CoverageCache &CoverageCache::getInstance() {
+    static CoverageCache cache;
+    return cache;
+  }
+
+
+  CoverageCache::CoverageCache() {
+    char *ptr = getenv("SSPICE_COVERAGE_CACHE");
+    cachePath = ptr == NULL ? "" : ptr;
+
+    if (!cachePath.empty()) {
+      load(cachePath);
+      dirty = false;
+    }
+  }
+
+
+  CoverageCache::~CoverageCache() {
+    if (!cachePath.empty() && dirty) {
+      try {
+        save(cachePath);
+      }
+      catch (exception &e) {
+        cerr << "Failed to write coverage cache " << cachePath << ": " << e.what() << endl;
+      }
+    }
+  }
+
+
+  map<int, vector<pair<double, double>>> CoverageCache::getCoverage(KernelPath kpath) {
+    optional<KernelCoverage> cached = find(kpath);
+    if (!cached) {
+      // computed without holding the lock, kernels can take a while to read
+      bool sclk = getKernelType(kpath) == "CK";
+      cached = KernelCoverage{0, 0, getBodyIntervals(kpath, !sclk), sclk};
+      insert(kpath, cached->bodies, sclk);
+    }
+
+    if (cached->sclk) {
+      sclkToEt(cached->bodies);
+    }
+    return move(cached->bodies);
+  }
+
+
+  optional<KernelCoverage> CoverageCache::find(KernelPath kpath) {
+    optional<pair<uintmax_t, int64_t>> stamp = fileStamp(kpath);
+    if (!stamp) {
+      return nullopt;
+    }
+
+    lock_guard<mutex> guard(lock);
+    auto it = entries.find(kpath);
+
+    if (it == entries.end() || it->second.size != stamp->first || it->second.mtime != stamp->second) {
+      return nullopt;
+    }
+    return it->second;
+  }
+
+
+  void CoverageCache::insert(KernelPath kpath, map<int, vector<pair<double, double>>> bodies, bool sclk) {
+    optional<pair<uintmax_t, int64_t>> stamp = fileStamp(kpath);
+    if (!stamp) {
+      throw invalid_argument("Kernel " + kpath.str() + " does not exist");
+    }
+
+    lock_guard<mutex> guard(lock);
+    entries[kpath] = {stamp->first, stamp->second, move(bodies), sclk};
+    dirty = true;
+  }
+
+
+  void CoverageCache::load(string cachePath) {
+    ifstream ifs(cachePath);
+    if (!ifs) {
+      return;
+    }
+
+    json cache = json::parse(ifs, nullptr, false);
+    if (cache.is_discarded() || !cache.is_object()) {
+      return;
+    }
+
+    lock_guard<mutex> guard(lock);
+    for (auto &[path, k] : cache.items()) {
+      // written before CK coverage was cached as SCLK, the ET times may be stale
+      if (!k.contains("sclk")) {
+        continue;
+      }
+
+      KernelCoverage coverage = {k.at("size"), k.at("mtime"), {}, k.at("sclk")};
+
+      for (auto &[body, intervals] : k.at("bodies").items()) {
+        coverage.bodies[stoi(body)] = intervals.get<vector<pair<double, double>>>();
+      }
+      entries[path] = move(coverage);
+    }
+    dirty = true;
+  }
+
+
+  void CoverageCache::save(string cachePath) {
+    json cache = toJson();
+
+    // write to a temporary file first so other processes never read a partial cache
+    fs::path tmpPath = cachePath + ".tmp";
+    {
+      ofstream ofs(tmpPath);
+      ofs << cache;
+    }
+    fs::rename(tmpPath, cachePath);
+
+    lock_guard<mutex> guard(lock);
+    dirty = false;
+  }
+
+
+  void CoverageCache::clear() {
+    lock_guard<mutex> guard(lock);
+    entries.clear();
+    dirty = true;
+  }
+
+
+  size_t CoverageCache::size() {
+    lock_guard<mutex> guard(lock);
+    return entries.size();
+  }
+
+
+  json CoverageCache::toJson() {
+    lock_guard<mutex> guard(lock);
+    json cache = json::object();
+
+    for (auto &[path, coverage] : entries) {
+      json bodies = json::object();
+      for (auto &[body, intervals] : coverage.bodies) {
+        bodies[to_string(body)] = intervals;
+      }
+      cache[path.str()] = {{"size", coverage.size}, {"mtime", coverage.mtime}, {"bodies", bodies}, {"sclk", coverage.sclk}};
+    }
+    return cache;
+  }
+
+
+  CoverageIndex::CoverageIndex(vector<KernelPath> const &kernels) {
+    for (size_t i = 0; i < kernels.size(); i++) {
+      this->kernels.emplace_back(kernels[i]);
+
+      for (auto &[start, stop] : getTimeIntervals(kernels[i])) {
+        nodes.push_back({start, stop, stop, i});
+      }
+    }
+
+    build();
+  }
+
+
+  CoverageIndex::CoverageIndex(vector<pair<KernelPath, vector<pair<double, double>>>> const &coverage) {
+    kernels.reserve(coverage.size());
+
+    for (size_t i = 0; i < coverage.size(); i++) {
+      kernels.emplace_back(coverage[i].first);
+
+      for (auto &[start, stop] : coverage[i].second) {
+        nodes.push_back({start, stop, stop, i});
+      }
+    }
+
+    build();
+  }
+
+
+  void CoverageIndex::add(KernelPath kernel, vector<pair<double, double>> const &intervals) {
+    kernels.emplace_back(kernel);
+
+    for (auto &[start, stop] : intervals) {
+      Node node = {start, stop, stop, kernels.size()-1};
+      auto pos = upper_bound(nodes.begin(), nodes.end(), start, [](double t, Node const &n) { return t < n.start; });
+      nodes.insert(pos, node);
+    }
+
+    buildSubtree(0, nodes.size());
+  }
+
+
+  vector<KernelPath> CoverageIndex::query(double time) const {
+    return query(time, time);
+  }
+
+
+  vector<KernelPath> CoverageIndex::query(double start, double stop) const {
+    vector<size_t> hits;
+    search(0, nodes.size(), start, stop, hits);
+
+    vector<bool> found(kernels.size(), false);
+    for (size_t i : hits) {
+      found[nodes[i].kernel] = true;
+    }
+    return collect(found);
+  }
+
+
+  vector<KernelPath> CoverageIndex::query(vector<double> const &times, bool isContiguous) const {
+    if (times.empty()) {
+      return {};
+    }
+
+    vector<double> sortedCopy;
+    vector<double> const *sorted = &times;
+    if (!is_sorted(times.begin(), times.end())) {
+      sortedCopy = times;
+      sort(sortedCopy.begin(), sortedCopy.end());
+      sorted = &sortedCopy;
+    }
+
+    double first = sorted->front();
+    double last = sorted->back();
+    vector<size_t> hits;
+    vector<bool> found(kernels.size(), false);
+
+    if (isContiguous) {
+      // an interval covers every time if it covers the first and the last
+      search(0, nodes.size(), first, first, hits);
+
+      for (size_t i : hits) {
+        if (nodes[i].stop >= last) {
+          found[nodes[i].kernel] = true;
+        }
+      }
+    }
+    else {
+      search(0, nodes.size(), first, last, hits);
+
+      for (size_t i : hits) {
+        Node const &node = nodes[i];
+        if (found[node.kernel]) {
+          continue;
+        }
+
+        // the first time at or after the start of the interval
+        auto it = lower_bound(sorted->begin(), sorted->end(), node.start);
+        if (it != sorted->end() && *it <= node.stop) {
+          found[node.kernel] = true;
+        }
+      }
+    }
+
+    return collect(found);
+  }
+
+
+  vector<KernelPath> const &CoverageIndex::getKernels() const {
+    return kernels;
+  }
+
+
+  size_t CoverageIndex::size() const {
+    return nodes.size();
+  }
+
+
+  void CoverageIndex::build() {
+    stable_sort(nodes.begin(), nodes.end(), [](Node const &a, Node const &b) { return a.start < b.start; });
+    buildSubtree(0, nodes.size());
+  }
+
+
+  double CoverageIndex::buildSubtree(size_t lo, size_t hi) {
+    if (lo >= hi) {
+      return -numeric_limits<double>::infinity();
+    }
+
+    size_t mid = lo + (hi - lo) / 2;
+    double left = buildSubtree(lo, mid);
+    double right = buildSubtree(mid+1, hi);
+
+    nodes[mid].maxStop = max({nodes[mid].stop, left, right});
+    return nodes[mid].maxStop;
+  }
+
+
+  void CoverageIndex::search(size_t lo, size_t hi, double start, double stop, vector<size_t> &hits) const {
+    if (lo >= hi) {
+      return;
+    }
+
+    size_t mid = lo + (hi - lo) / 2;
+
+    // nothing in this subtree ends late enough
+    if (nodes[mid].maxStop < start) {
+      return;
+    }
+
+    search(lo, mid, start, stop, hits);
+
+    // everything to the right starts after this node
+    if (nodes[mid].start > stop) {
+      return;
+    }
+
+    if (nodes[mid].stop >= start) {
+      hits.emplace_back(mid);
+    }
+
+    search(mid+1, hi, start, stop, hits);
+  }
+
+
+  vector<KernelPath> CoverageIndex::collect(vector<bool> const &found) const {
+    vector<KernelPath> res;
+
+    for (size_t i = 0; i < kernels.size(); i++) {
+      if (found[i]) {
+        res.emplace_back(kernels[i]);
+      }
+    }
+    return res;
+  }
+}
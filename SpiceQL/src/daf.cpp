@@ -0,0 +1,105 @@
+/**
+  * @file
+  *
+  *
+ **/
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include <SpiceUsr.h>
+
+#include "daf.h"
+#include "spice_types.h"
+
+using namespace std;
+
+namespace SpiceQL {
+
+  /**
+   * @brief Merge intervals into a window, like wninsd_c
+   *
+   * Overlapping and touching intervals are combined.
+   **/
+  static vector<pair<double, double>> mergeIntervals(vector<pair<double, double>> intervals) {
+    sort(intervals.begin(), intervals.end());
+
+    vector<pair<double, double>> window;
+    for (auto &interval : intervals) {
+      if (!window.empty() && interval.first <= window.back().second) {
+        window.back().second = max(window.back().second, interval.second);
+      }
+      else {
+        window.emplace_back(interval);
+      }
+    }
+    return window;
+  }
+
+
+  optional<string> readKernelType(string kernelPath) {
+    ifstream ifs(kernelPath, ios::binary);
+    if (!ifs) {
+      return nullopt;
+    }
+
+    char buffer[8] = {};
+    ifs.read(buffer, 8);
+    // text kernels have the ID word on its own line
+    string idWord(buffer, ifs.gcount());
+    idWord = idWord.substr(0, idWord.find_first_of(string(" \t\r\n\0", 5)));
+
+    string arch = idWord.substr(0, 4);
+    string type = idWord.size() > 4 ? idWord.substr(4) : "";
+
+    if ((arch == "DAF/" || arch == "DAS/") && !type.empty()) {
+      return type;
+    }
+    else if (arch == "KPL/") {
+      return type == "MK" ? "META" : "TEXT";
+    }
+
+    return nullopt;
+  }
+
+
+  map<int, vector<pair<double, double>>> readDafCoverage(string kernelPath, bool convertSclk) {
+    MappedKernel daf(kernelPath);
+    string type = daf.getKernelType();
+
+    if ((type != "SPK" && type != "CK") || daf.getND() != 2 || daf.getNI() != 6) {
+      throw invalid_argument(kernelPath + " is not an SPK or CK");
+    }
+
+    map<int, vector<pair<double, double>>> intervals;
+    for (auto &summary : daf.getSummaries()) {
+      intervals[summary.ints[0]].emplace_back(summary.doubles[0], summary.doubles[1]);
+    }
+
+    map<int, vector<pair<double, double>>> coverage;
+    for (auto &[body, bodyIntervals] : intervals) {
+      coverage[body] = mergeIntervals(bodyIntervals);
+    }
+
+    // CK times are encoded SCLK, merging first is fine as the conversion is monotonic
+    if (type == "CK" && convertSclk) {
+      sclkToEt(coverage);
+    }
+
+    return coverage;
+  }
+
+
+  void sclkToEt(map<int, vector<pair<double, double>>> &coverage) {
+    for (auto &[body, window] : coverage) {
+      SpiceInt clockId;
+      ckmeta_c(body, "SCLK", &clockId);
+
+      for (auto &[start, stop] : window) {
+        sct2e_c(clockId, start, &start);
+        sct2e_c(clockId, stop, &stop);
+      }
+    }
+  }
+}
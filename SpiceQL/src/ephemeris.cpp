@@ -0,0 +1,540 @@
+/**
+  * @file
+  *
+  *
+ **/
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+#include "ephemeris.h"
+
+using namespace std;
+
+namespace SpiceQL {
+
+  //! give up splitting intervals after this many halvings of the cadence
+  static const size_t MAX_REFINEMENTS = 32;
+
+
+  /**
+   * @brief Get the times from start to stop at a cadence, always including stop
+   **/
+  static vector<double> cadenceTimes(double startEt, double stopEt, double cadence) {
+    if (!(stopEt >= startEt)) {
+      throw invalid_argument("Stop time " + to_string(stopEt) + " is before start time " + to_string(startEt));
+    }
+
+    if (!(cadence > 0)) {
+      throw invalid_argument("Cadence must be positive");
+    }
+
+    vector<double> times;
+    for (size_t i = 0; startEt + i * cadence < stopEt; i++) {
+      times.emplace_back(startEt + i * cadence);
+    }
+    times.emplace_back(stopEt);
+    return times;
+  }
+
+
+  /**
+   * @brief Get the interval containing a time, starting the search from the last interval used
+   *
+   * @return index of the first sample of the interval
+   **/
+  static size_t findInterval(vector<double> const &times, double et, size_t hint) {
+    if (times.size() < 2 || (times[hint] <= et && et <= times[hint+1])) {
+      return hint;
+    }
+
+    // sorted times usually fall in the next interval
+    if (hint + 2 < times.size() && times[hint+1] <= et && et <= times[hint+2]) {
+      return hint + 1;
+    }
+
+    size_t i = upper_bound(times.begin(), times.end(), et) - times.begin();
+    return min(max(i, size_t(1)), times.size() - 1) - 1;
+  }
+
+
+  /**
+   * @brief Multiply SPICE-style quaternions, like qxq_c
+   **/
+  static array<double, 4> qmul(array<double, 4> const &a, array<double, 4> const &b) {
+    return {a[0]*b[0] - a[1]*b[1] - a[2]*b[2] - a[3]*b[3],
+            a[0]*b[1] + a[1]*b[0] + a[2]*b[3] - a[3]*b[2],
+            a[0]*b[2] + a[2]*b[0] + a[3]*b[1] - a[1]*b[3],
+            a[0]*b[3] + a[3]*b[0] + a[1]*b[2] - a[2]*b[1]};
+  }
+
+
+  static array<double, 4> qconj(array<double, 4> const &q) {
+    return {q[0], -q[1], -q[2], -q[3]};
+  }
+
+
+  /**
+   * @brief Convert a quaternion to a rotation vector, taking the shorter way around
+   **/
+  static array<double, 3> qlog(array<double, 4> q) {
+    if (q[0] < 0) {
+      q = {-q[0], -q[1], -q[2], -q[3]};
+    }
+
+    double norm = sqrt(q[1]*q[1] + q[2]*q[2] + q[3]*q[3]);
+    double scale = norm < 1e-12 ? 2 : 2 * atan2(norm, q[0]) / norm;
+    return {q[1] * scale, q[2] * scale, q[3] * scale};
+  }
+
+
+  /**
+   * @brief Convert a rotation vector to a quaternion
+   **/
+  static array<double, 4> qexp(array<double, 3> const &r) {
+    double angle = sqrt(r[0]*r[0] + r[1]*r[1] + r[2]*r[2]);
+    double scale = angle < 1e-12 ? 0.5 : sin(angle / 2) / angle;
+    return {cos(angle / 2), r[0] * scale, r[1] * scale, r[2] * scale};
+  }
+
+
+  /**
+   * @brief Get the angle of the rotation between two quaternions
+   **/
+  static double qangle(array<double, 4> const &a, array<double, 4> const &b) {
+    array<double, 4> diff = qmul(qconj(a), b);
+    return 2 * atan2(sqrt(diff[1]*diff[1] + diff[2]*diff[2] + diff[3]*diff[3]), abs(diff[0]));
+  }
+
+
+  static array<double, 3> cross(array<double, 3> const &a, array<double, 3> const &b) {
+    return {a[1]*b[2] - a[2]*b[1], a[2]*b[0] - a[0]*b[2], a[0]*b[1] - a[1]*b[0]};
+  }
+
+
+  CachedEphemeris::CachedEphemeris(string target, string observer, double startEt, double stopEt, double cadence,
+                                   string frame, string abcorr, double tolerance) :
+    CachedEphemeris([=](span<const double> ets) { return getTargetStates(ets, target, observer, frame, abcorr); },
+                    startEt, stopEt, cadence, tolerance) { }
+
+
+  CachedEphemeris::CachedEphemeris(Sampler sampler, double startEt, double stopEt, double cadence, double tolerance) :
+    sampler(sampler), startEt(startEt), stopEt(stopEt) {
+    if (!(tolerance >= 0)) {
+      throw invalid_argument("Tolerance can't be negative");
+    }
+
+    build(cadence, tolerance);
+  }
+
+
+  void CachedEphemeris::build(double cadence, double tolerance) {
+    times = cadenceTimes(startEt, stopEt, cadence);
+
+    targetStates states = sampler(times);
+    sampleCount = times.size();
+
+    samples.resize(times.size());
+    for (size_t i = 0; i < times.size(); i++) {
+      for (size_t c = 0; c < 7; c++) {
+        samples[i][c] = states.data[c * states.n + i];
+      }
+    }
+
+    // intervals that haven't been checked yet, by the index of their first sample
+    vector<size_t> pending(times.size() - 1);
+    iota(pending.begin(), pending.end(), 0);
+
+    for (size_t round = 0; !pending.empty(); round++) {
+      vector<double> mids;
+      for (size_t i : pending) {
+        mids.emplace_back(times[i] + (times[i+1] - times[i]) / 2);
+      }
+
+      targetStates truth = sampler(mids);
+      sampleCount += mids.size();
+
+      // index into mids for each interval that needs to be split
+      vector<size_t> splits(times.size(), numeric_limits<size_t>::max());
+      bool refine = false;
+
+      for (size_t k = 0; k < pending.size(); k++) {
+        double interp[7];
+        interpolate(pending[k], mids[k], interp);
+
+        double err = 0;
+        for (size_t c = 0; c < 3; c++) {
+          double diff = interp[c] - truth.data[c * truth.n + k];
+          err += diff * diff;
+        }
+        err = sqrt(err);
+
+        if (tolerance > 0 && err > tolerance && round < MAX_REFINEMENTS) {
+          splits[pending[k]] = k;
+          refine = true;
+        }
+        else {
+          maxError = max(maxError, err);
+        }
+      }
+
+      if (!refine) {
+        break;
+      }
+
+      // insert the midpoints of the split intervals, both halves need to be checked again
+      vector<double> newTimes;
+      vector<array<double, 7>> newSamples;
+      pending.clear();
+
+      for (size_t i = 0; i < times.size(); i++) {
+        newTimes.emplace_back(times[i]);
+        newSamples.emplace_back(samples[i]);
+
+        size_t k = splits[i];
+        if (k != numeric_limits<size_t>::max()) {
+          array<double, 7> mid;
+          for (size_t c = 0; c < 7; c++) {
+            mid[c] = truth.data[c * truth.n + k];
+          }
+
+          pending.emplace_back(newTimes.size() - 1);
+          newTimes.emplace_back(mids[k]);
+          newSamples.emplace_back(mid);
+          pending.emplace_back(newTimes.size() - 1);
+        }
+      }
+
+      times = move(newTimes);
+      samples = move(newSamples);
+    }
+  }
+
+
+  void CachedEphemeris::interpolate(size_t i, double et, double *out) const {
+    if (times.size() == 1) {
+      copy(samples[0].begin(), samples[0].end(), out);
+      return;
+    }
+
+    array<double, 7> const &a = samples[i];
+    array<double, 7> const &b = samples[i+1];
+    double h = times[i+1] - times[i];
+    double s = (et - times[i]) / h;
+    double s2 = s * s;
+    double s3 = s2 * s;
+
+    // cubic Hermite basis and its derivative with respect to s
+    double h00 = 2*s3 - 3*s2 + 1;
+    double h10 = s3 - 2*s2 + s;
+    double h01 = -2*s3 + 3*s2;
+    double h11 = s3 - s2;
+
+    double d00 = 6*s2 - 6*s;
+    double d10 = 3*s2 - 4*s + 1;
+    double d01 = -6*s2 + 6*s;
+    double d11 = 3*s2 - 2*s;
+
+    for (size_t c = 0; c < 3; c++) {
+      double p0 = a[c], p1 = b[c];
+      double m0 = a[c+3] * h, m1 = b[c+3] * h;
+
+      out[c] = h00 * p0 + h10 * m0 + h01 * p1 + h11 * m1;
+      out[c+3] = (d00 * p0 + d10 * m0 + d01 * p1 + d11 * m1) / h;
+    }
+
+    // light time changes slowly enough to interpolate linearly
+    out[6] = a[6] + s * (b[6] - a[6]);
+  }
+
+
+  targetState CachedEphemeris::getState(double et) const {
+    targetStates states = getStates(span<const double>(&et, 1));
+
+    targetState res;
+    for (size_t c = 0; c < 6; c++) {
+      res.starg[c] = states.data[c];
+    }
+    res.lt = states.data[targetStates::LT];
+    return res;
+  }
+
+
+  targetStates CachedEphemeris::getStates(span<const double> ets) const {
+    targetStates res;
+    res.n = ets.size();
+    res.data.resize(7 * res.n);
+
+    vector<size_t> outside;
+    size_t i = 0;
+
+    for (size_t k = 0; k < ets.size(); k++) {
+      double et = ets[k];
+      if (et < startEt || et > stopEt) {
+        outside.emplace_back(k);
+        continue;
+      }
+
+      i = findInterval(times, et, i);
+
+      double out[7];
+      interpolate(i, et, out);
+      for (size_t c = 0; c < 7; c++) {
+        res.data[c * res.n + k] = out[c];
+      }
+    }
+
+    if (!outside.empty()) {
+      vector<double> outsideEts;
+      for (size_t k : outside) {
+        outsideEts.emplace_back(ets[k]);
+      }
+
+      targetStates direct = sampler(outsideEts);
+      for (size_t j = 0; j < outside.size(); j++) {
+        for (size_t c = 0; c < 7; c++) {
+          res.data[c * res.n + outside[j]] = direct.data[c * direct.n + j];
+        }
+      }
+    }
+
+    return res;
+  }
+
+
+  double CachedEphemeris::getMaxError() const {
+    return maxError;
+  }
+
+
+  size_t CachedEphemeris::getSampleCount() const {
+    return sampleCount;
+  }
+
+
+  size_t CachedEphemeris::size() const {
+    return times.size();
+  }
+
+
+  CachedOrientation::CachedOrientation(int toFrame, int refFrame, double startEt, double stopEt, double cadence,
+                                       double tolerance) :
+    CachedOrientation(toFrame, refFrame, cadenceTimes(startEt, stopEt, cadence), tolerance) { }
+
+
+  CachedOrientation::CachedOrientation(int toFrame, int refFrame, vector<double> times, double tolerance) :
+    CachedOrientation([=](span<const double> ets, span<double> quats, span<double> avs) {
+                        return getTargetOrientations(ets, toFrame, refFrame, quats, avs);
+                      },
+                      times, tolerance) { }
+
+
+  CachedOrientation::CachedOrientation(Sampler sampler, vector<double> times, double tolerance) :
+    sampler(sampler), times(times) {
+    if (this->times.empty()) {
+      throw invalid_argument("No times to sample");
+    }
+
+    if (!(tolerance >= 0)) {
+      throw invalid_argument("Tolerance can't be negative");
+    }
+
+    sort(this->times.begin(), this->times.end());
+    this->times.erase(unique(this->times.begin(), this->times.end()), this->times.end());
+    build(tolerance);
+  }
+
+
+  void CachedOrientation::build(double tolerance) {
+    size_t n = times.size();
+    vector<double> sampledQuats(4 * n);
+    vector<double> sampledAvs(3 * n);
+    sampler(times, sampledQuats, sampledAvs);
+
+    quats.resize(n);
+    avs.resize(n);
+    for (size_t i = 0; i < n; i++) {
+      copy_n(sampledQuats.begin() + 4 * i, 4, quats[i].begin());
+      copy_n(sampledAvs.begin() + 3 * i, 3, avs[i].begin());
+    }
+
+    if (n < 2) {
+      return;
+    }
+
+    vector<double> mids;
+    for (size_t i = 0; i + 1 < n; i++) {
+      mids.emplace_back(times[i] + (times[i+1] - times[i]) / 2);
+    }
+
+    vector<double> midQuats(4 * mids.size());
+    sampler(mids, midQuats, {});
+
+    methods.resize(mids.size());
+    for (size_t i = 0; i < mids.size(); i++) {
+      array<double, 4> truth;
+      copy_n(midQuats.begin() + 4 * i, 4, truth.begin());
+
+      array<double, 4> interp;
+      array<double, 3> av;
+      interpolate(i, SLERP, mids[i], interp.data(), av.data());
+      double slerpErr = qangle(interp, truth);
+      double hermiteErr = numeric_limits<double>::infinity();
+
+      if (!isnan(avs[i][0]) && !isnan(avs[i+1][0])) {
+        interpolate(i, HERMITE, mids[i], interp.data(), av.data());
+        hermiteErr = qangle(interp, truth);
+      }
+
+      double err = min(slerpErr, hermiteErr);
+      if (tolerance > 0 && err > tolerance) {
+        methods[i] = DIRECT;
+      }
+      else {
+        methods[i] = hermiteErr <= slerpErr ? HERMITE : SLERP;
+        maxError = max(maxError, err);
+      }
+    }
+  }
+
+
+  void CachedOrientation::interpolate(size_t i, Method method, double et, double *quat, double *av) const {
+    if (times.size() == 1) {
+      copy(quats[0].begin(), quats[0].end(), quat);
+      copy(avs[0].begin(), avs[0].end(), av);
+      return;
+    }
+
+    array<double, 4> const &q0 = quats[i];
+    array<double, 3> const &w0 = avs[i];
+    array<double, 3> const &w1 = avs[i+1];
+    double h = times[i+1] - times[i];
+    double s = (et - times[i]) / h;
+
+    // rotation from the first sample to the second, q1 = q0 * exp(r1)
+    array<double, 3> r1 = qlog(qmul(qconj(q0), quats[i+1]));
+    array<double, 3> r;
+
+    if (method == HERMITE) {
+      // the rotation vector's rate is -av at the start, and -av through the inverse
+      // right Jacobian of r1 at the end
+      double angle2 = r1[0]*r1[0] + r1[1]*r1[1] + r1[2]*r1[2];
+      double angle = sqrt(angle2);
+      double c = angle < 1e-4 ? 1.0 / 12 : 1 / angle2 - (1 + cos(angle)) / (2 * angle * sin(angle));
+
+      array<double, 3> rw = cross(r1, w1);
+      array<double, 3> rrw = cross(r1, rw);
+
+      double s2 = s * s;
+      double s3 = s2 * s;
+      double h10 = s3 - 2*s2 + s;
+      double h01 = -2*s3 + 3*s2;
+      double h11 = s3 - s2;
+
+      for (size_t c3 = 0; c3 < 3; c3++) {
+        double m0 = -h * w0[c3];
+        double m1 = -h * (w1[c3] + 0.5 * rw[c3] + c * rrw[c3]);
+        r[c3] = h10 * m0 + h01 * r1[c3] + h11 * m1;
+      }
+    }
+    else {
+      for (size_t c3 = 0; c3 < 3; c3++) {
+        r[c3] = s * r1[c3];
+      }
+    }
+
+    array<double, 4> q = qmul(q0, qexp(r));
+    copy(q.begin(), q.end(), quat);
+
+    for (size_t c3 = 0; c3 < 3; c3++) {
+      av[c3] = w0[c3] + s * (w1[c3] - w0[c3]);
+    }
+  }
+
+
+  targetOrientation CachedOrientation::getOrientation(double et) const {
+    array<double, 4> quat;
+    array<double, 3> av;
+
+    size_t fallbacks = getOrientations(span<const double>(&et, 1), quat, av);
+
+    if (fallbacks == 0) return {quat, av};
+    return {quat, nullopt};
+  }
+
+
+  size_t CachedOrientation::getOrientations(span<const double> ets, span<double> quatsOut, span<double> avsOut) const {
+    bool computeAv = !avsOut.empty();
+
+    if (quatsOut.size() < 4 * ets.size() || (computeAv && avsOut.size() < 3 * ets.size())) {
+      throw invalid_argument("Orientation buffers are too small for " + to_string(ets.size()) + " times");
+    }
+
+    vector<size_t> direct;
+    size_t fallbacks = 0;
+    size_t i = 0;
+
+    for (size_t k = 0; k < ets.size(); k++) {
+      double et = ets[k];
+      if (et < times.front() || et > times.back()) {
+        direct.emplace_back(k);
+        continue;
+      }
+
+      i = findInterval(times, et, i);
+      Method method = methods.empty() ? SLERP : methods[i];
+      if (method == DIRECT) {
+        direct.emplace_back(k);
+        continue;
+      }
+
+      double av[3];
+      interpolate(i, method, et, &quatsOut[4 * k], av);
+
+      if (computeAv) {
+        copy(av, av + 3, &avsOut[3 * k]);
+        if (isnan(av[0])) {
+          fallbacks++;
+        }
+      }
+    }
+
+    if (!direct.empty()) {
+      vector<double> directEts;
+      for (size_t k : direct) {
+        directEts.emplace_back(ets[k]);
+      }
+
+      vector<double> directQuats(4 * direct.size());
+      vector<double> directAvs(computeAv ? 3 * direct.size() : 0);
+      fallbacks += sampler(directEts, directQuats, directAvs);
+
+      for (size_t j = 0; j < direct.size(); j++) {
+        copy_n(directQuats.begin() + 4 * j, 4, &quatsOut[4 * direct[j]]);
+        if (computeAv) {
+          copy_n(directAvs.begin() + 3 * j, 3, &avsOut[3 * direct[j]]);
+        }
+      }
+    }
+
+    return fallbacks;
+  }
+
+
+  double CachedOrientation::getMaxError() const {
+    return maxError;
+  }
+
+
+  size_t CachedOrientation::getDirectIntervals() const {
+    return count(methods.begin(), methods.end(), DIRECT);
+  }
+
+
+  size_t CachedOrientation::size() const {
+    return times.size();
+  }
+}
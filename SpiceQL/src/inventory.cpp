@@ -0,0 +1,284 @@
+/**
+  * @file
+  *
+  *
+ **/
+
+#include <algorithm>
+#include <fstream>
+#include <unordered_map>
+
+#include <ghc/fs_std.hpp>
+
+#include "inventory.h"
+#include "spice_types.h"
+#include "utils.h"
+
+using json = nlohmann::json;
+using namespace std;
+
+namespace SpiceQL {
+
+  /**
+   * @brief Used here to compare modification times
+   **/
+  static int64_t toTicks(fs::file_time_type time) {
+    return static_cast<int64_t>(time.time_since_epoch().count());
+  }
+
+
+  KernelInventory::KernelInventory(string root, string indexPath) {
+    fs::path normalized = fs::path(root).lexically_normal();
+    this->root = normalized.has_filename() ? normalized.string() : normalized.parent_path().string();
+
+    bool loaded = false;
+    if (!indexPath.empty() && fs::exists(indexPath)) {
+      ifstream ifs(indexPath);
+      json index = json::parse(ifs, nullptr, false);
+
+      // an unreadable index or an index for a different area gets rebuilt
+      if (index.is_object() && index.value("root", "") == this->root) {
+        try {
+          for (auto &[dir, mtime] : index.at("directories").items()) {
+            directories.emplace(dir, mtime.get<int64_t>());
+          }
+
+          for (auto &k : index.at("kernels")) {
+            InventoryEntry e = {k.at("path"), k.at("size"), k.at("mtime"), k.at("type"), k.at("mission")};
+            entries.emplace(e.path, e);
+          }
+          loaded = true;
+        }
+        catch (json::exception &e) {
+          // missing or mistyped fields, don't keep half of it
+          entries.clear();
+          directories.clear();
+        }
+      }
+    }
+
+    bool changed = true;
+    if (loaded) {
+      changed = refresh();
+    }
+    else {
+      scanDirectory(this->root);
+    }
+    updatePaths();
+
+    if (!indexPath.empty() && changed) {
+      save(indexPath);
+    }
+  }
+
+
+  bool KernelInventory::refresh() {
+    bool changed = false;
+    error_code ec;
+
+    // re-examine known files
+    for (auto it = entries.begin(); it != entries.end();) {
+      fs::path p = it->first;
+      uintmax_t size = fs::file_size(p, ec);
+      int64_t mtime = ec ? 0 : toTicks(fs::last_write_time(p, ec));
+
+      if (ec) {
+        // the file was removed
+        it = entries.erase(it);
+        changed = true;
+        continue;
+      }
+
+      if (size != it->second.size || mtime != it->second.mtime) {
+        it->second = makeEntry(it->first);
+        changed = true;
+      }
+      ++it;
+    }
+
+    // list directories that had files added or removed
+    vector<string> modified;
+    for (auto it = directories.begin(); it != directories.end();) {
+      int64_t mtime = toTicks(fs::last_write_time(it->first, ec));
+
+      if (ec || !fs::is_directory(it->first, ec)) {
+        it = directories.erase(it);
+        changed = true;
+        continue;
+      }
+
+      if (mtime != it->second) {
+        it->second = mtime;
+        modified.emplace_back(it->first);
+      }
+      ++it;
+    }
+
+    for (auto &dir : modified) {
+      for (auto &entry : fs::directory_iterator(dir)) {
+        string p = entry.path().string();
+
+        // match ls, directory symlinks are not followed and broken links are skipped
+        if (!entry.exists() || (entry.is_symlink() && entry.is_directory())) {
+          continue;
+        }
+
+        if (entry.is_directory()) {
+          if (directories.find(p) == directories.end()) {
+            scanDirectory(p);
+          }
+        }
+        else if (entries.find(p) == entries.end()) {
+          entries.emplace(p, makeEntry(p));
+        }
+      }
+      changed = true;
+    }
+
+    if (changed) {
+      updatePaths();
+    }
+    return changed;
+  }
+
+
+  void KernelInventory::save(string indexPath) const {
+    ofstream ofs(indexPath);
+    ofs << toJson();
+  }
+
+
+  vector<string> const &KernelInventory::getPaths() const {
+    return paths;
+  }
+
+
+  vector<string> KernelInventory::getPaths(vector<string> const &types, vector<string> const &missions) const {
+    auto matches = [](vector<string> const &values, string const &value) {
+      return values.empty() || find(values.begin(), values.end(), value) != values.end();
+    };
+
+    vector<string> res;
+    for (auto &[path, entry] : entries) {
+      if (matches(types, entry.type) && matches(missions, entry.mission)) {
+        res.emplace_back(path);
+      }
+    }
+    return res;
+  }
+
+
+  vector<string> KernelInventory::glob(regex const &reg) const {
+    vector<string> paths;
+
+    for (auto &[path, entry] : entries) {
+      if (regex_search(path.c_str(), reg)) {
+        paths.emplace_back(path);
+      }
+    }
+    return paths;
+  }
+
+
+  vector<InventoryEntry> KernelInventory::getEntries(string type) const {
+    vector<InventoryEntry> res;
+
+    for (auto &[path, entry] : entries) {
+      if (entry.type == type) {
+        res.emplace_back(entry);
+      }
+    }
+    return res;
+  }
+
+
+  map<string, InventoryEntry> const &KernelInventory::getEntries() const {
+    return entries;
+  }
+
+
+  map<string, int64_t> const &KernelInventory::getDirectories() const {
+    return directories;
+  }
+
+
+  string const &KernelInventory::getRoot() const {
+    return root;
+  }
+
+
+  json KernelInventory::toJson() const {
+    json index;
+    index["root"] = root;
+    index["directories"] = directories;
+    index["kernels"] = json::array();
+
+    for (auto &[path, e] : entries) {
+      index["kernels"].push_back({{"path", e.path}, {"size", e.size}, {"mtime", e.mtime},
+                                  {"type", e.type}, {"mission", e.mission}});
+    }
+    return index;
+  }
+
+
+  string KernelInventory::guessKernelType(string path) {
+    static const unordered_map<string, string> extensions = {
+      {".bc", "ck"}, {".bsp", "spk"}, {".tls", "lsk"}, {".tsc", "sclk"},
+      {".tf", "fk"}, {".ti", "ik"}, {".tpc", "pck"}, {".bpc", "pck"},
+      {".bds", "dsk"}, {".tm", "mk"}, {".bes", "ek"}
+    };
+
+    fs::path p = path;
+    string dirName = toLower(p.parent_path().filename().string());
+
+    if (find(Kernel::TYPES.begin(), Kernel::TYPES.end(), dirName) != Kernel::TYPES.end()) {
+      return dirName;
+    }
+
+    auto it = extensions.find(toLower(p.extension().string()));
+    return it != extensions.end() ? it->second : "na";
+  }
+
+
+  void KernelInventory::scanDirectory(string dir) {
+    directories[dir] = toTicks(fs::last_write_time(dir));
+
+    for (auto &entry : fs::directory_iterator(dir)) {
+      string p = entry.path().string();
+
+      if (!entry.exists() || (entry.is_symlink() && entry.is_directory())) {
+        continue;
+      }
+
+      if (entry.is_directory()) {
+        scanDirectory(p);
+      }
+      else {
+        entries[p] = makeEntry(p);
+      }
+    }
+  }
+
+
+  void KernelInventory::updatePaths() {
+    paths.clear();
+    paths.reserve(entries.size());
+
+    for (auto &[path, entry] : entries) {
+      paths.emplace_back(path);
+    }
+  }
+
+
+  InventoryEntry KernelInventory::makeEntry(string path) const {
+    InventoryEntry e;
+    e.path = path;
+    e.size = fs::file_size(path);
+    e.mtime = toTicks(fs::last_write_time(path));
+    e.type = guessKernelType(path);
+
+    fs::path relative = fs::path(path).lexically_relative(root);
+    e.mission = distance(relative.begin(), relative.end()) > 1 ? relative.begin()->string() : "";
+    return e;
+  }
+}
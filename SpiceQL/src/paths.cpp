@@ -0,0 +1,94 @@
+/**
+  * @file
+  *
+  *
+ **/
+
+#include "paths.h"
+
+using json = nlohmann::json;
+using namespace std;
+
+namespace SpiceQL {
+
+  KernelPath::KernelPath() : KernelPath(string_view()) { }
+
+
+  KernelPath::KernelPath(string_view path) : path(PathTable::getInstance().intern(path)) { }
+
+
+  KernelPath::KernelPath(string const &path) : KernelPath(string_view(path)) { }
+
+
+  KernelPath::KernelPath(char const *path) : KernelPath(string_view(path)) { }
+
+
+  strong_ordering KernelPath::operator<=>(KernelPath const &other) const {
+    if (path == other.path) {
+      return strong_ordering::equal;
+    }
+    return path->compare(*other.path) <=> 0;
+  }
+
+
+  PathTable &PathTable::getInstance() {
+    // leaked on purpose, see the doc comment
+    static PathTable *table = new PathTable();
+    return *table;
+  }
+
+
+  string const *PathTable::intern(string_view path) {
+    lock_guard<mutex> guard(lock);
+
+    auto it = index.find(path);
+    if (it != index.end()) {
+      return it->second;
+    }
+
+    string const *interned = &paths.emplace_back(path);
+    index.emplace(*interned, interned);
+    return interned;
+  }
+
+
+  size_t PathTable::size() {
+    lock_guard<mutex> guard(lock);
+    return paths.size();
+  }
+
+
+  vector<KernelPath> jsonArrayToPaths(json const &arr) {
+    vector<KernelPath> res;
+
+    if (arr.is_array()) {
+      res.reserve(arr.size());
+      for (auto &it : arr) {
+        res.emplace_back(it.get_ref<string const &>());
+      }
+    }
+    else if (arr.is_string()) {
+      res.emplace_back(arr.get_ref<string const &>());
+    }
+    else {
+      throw invalid_argument("Input json is not a valid Json array");
+    }
+
+    return res;
+  }
+
+
+  void to_json(json &j, KernelPath const &path) {
+    j = path.str();
+  }
+
+
+  void from_json(json const &j, KernelPath &path) {
+    path = KernelPath(j.get_ref<string const &>());
+  }
+
+
+  ostream &operator<<(ostream &os, KernelPath const &path) {
+    return os << path.str();
+  }
+}
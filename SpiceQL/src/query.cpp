@@ -7,12 +7,17 @@
  **/
 #include <fstream>
 #include <algorithm>
+#include <map>
+#include <set>
 
 #include <SpiceUsr.h>
 
 #include <ghc/fs_std.hpp>
 
+#include "coverage.h"
+#include "inventory.h"
 #include "query.h"
+#include "results.h"
 #include "spice_types.h"
 #include "utils.h"
 
@@ -21,6 +26,9 @@ using namespace std;
 
 namespace SpiceQL {
 
+  //! kernel types searched for when getting all kernels for a mission
+  static const vector<string> SEARCH_TYPES = {"ck", "spk", "tspk", "fk", "ik", "iak", "pck", "lsk", "sclk"};
+
 
  std::string getKernelStringValue(std::string key) {
    // check to make sure the key exists when calling findKeyWords(key) 
@@ -76,10 +84,12 @@ namespace SpiceQL {
 
 
   json getLatestKernels(json kernels) {
+    // only kernel lists are replaced below, so the keys don't change
+    JsonKeyIndex index(kernels);
+
     // the kernels group is now the conf with
     for(auto &kernelType: {"ck", "spk", "tspk", "fk", "ik", "iak", "pck", "lsk"}) {
-        vector<json::json_pointer> catPointers = findKeyInJson(kernels, kernelType, true);
-        for(auto &p : catPointers) {
+        for(auto &p : index.find(kernelType)) {
           for(auto qual: Kernel::QUALITIES) {
             if(!kernels[p].contains(qual)){
               continue;
@@ -104,7 +114,7 @@ namespace SpiceQL {
         }
     }
 
-    vector<json::json_pointer> pointers = findKeyInJson(kernels, "sclk", true);
+    vector<json::json_pointer> pointers = index.find("sclk");
     for(auto &p : pointers) {
       if(kernels.at(p).contains("kernels")) {
         p /= "kernels";
@@ -121,84 +131,235 @@ namespace SpiceQL {
   }
 
   /**
-    * @brief glob, but with json
+    * @brief globKernels, but for multiple kernel types at once
     *
-    * Lambda for globbing files from a regular expression stored
-    * in json. As they can be a single expression or a
-    * list, we need to massage the json a little.
+    * Collects the json lists of regexes for every category, quality and dependency of
+    * the kernel types and matches all of them against the listing in a single pass
+    * using a cached PatternSet. The matching paths go straight into the typed results.
     *
-    * @param root root path to search
-    * @param r json list of regexes
-    * @returns vector of paths
+    * @param files listing of the files to search
+    * @param conf JSON config file
+    * @param kernelTypes kernel types to glob, see Kernel::TYPES
+    * @param filenameOnly if true, the regexes are only matched against file names
+    * @returns kernel lists
    **/
-  vector<string> getPathsFromRegex (string root, json r) {
-      vector<string> regexes = jsonArrayToVector(r);
-      regex reg(fmt::format("({})", fmt::join(regexes, "|")));
-      vector<string> paths = glob(root, reg, true);
-
-      return paths;
-  };
-
+  static KernelQueryResult globKernelTypes(vector<string> const &files, json const &conf, vector<string> const &kernelTypes,
+                                           bool filenameOnly=false) {
+    KernelQueryResult ret;
 
-  json globKernels(string root, json conf, string kernelType) {
-    vector<json::json_pointer> pointers = findKeyInJson(conf, kernelType, true);
-
-    json ret;
+    // where the paths matching each list of regexes go in the results, map nodes don't move
+    vector<optional<vector<KernelPath>> *> targets;
+    vector<vector<string>> patterns;
 
-    // iterate pointers
-    for(auto pointer : pointers) {
-      json category = conf[pointer];
+    auto addPatterns = [&](optional<vector<KernelPath>> &target, json const &regexes) {
+      targets.emplace_back(&target);
+      patterns.emplace_back(jsonArrayToVector(regexes));
+    };
 
-      if (category.contains("kernels")) {
-        ret[pointer]["kernels"] = getPathsFromRegex(root, category.at("kernels"));
+    auto addList = [&](KernelList &list, json const &category, bool hasKernels) {
+      if (hasKernels) {
+        addPatterns(list.kernels, category.at("kernels"));
       }
 
       if (category.contains("deps")) {
-        if (category.at("deps").contains("sclk")) {
-          ret[pointer]["deps"]["sclk"] = getPathsFromRegex(root, category.at("deps").at("sclk"));
+        json const &deps = category.at("deps");
+        if (deps.contains("sclk")) {
+          addPatterns(list.sclk, deps.at("sclk"));
         }
-        if (category.at("deps").contains("pck")) {
-          ret[pointer]["deps"]["pck"] = getPathsFromRegex(root, category.at("deps").at("pck"));
+        if (deps.contains("pck")) {
+          addPatterns(list.pck, deps.at("pck"));
         }
-        if (category.at("deps").contains("objs")) {
-          ret[pointer]["deps"]["objs"] = category.at("deps").at("objs");
+        if (deps.contains("objs")) {
+          list.objs = jsonArrayToVector(deps.at("objs"));
         }
       }
+    };
 
-      // iterate over potential qualities
-      for(auto qual: Kernel::QUALITIES) {
-        if(!category.contains(qual)) {
-          continue;
-        }
+    JsonKeyIndex index(conf);
 
-        ret[pointer][qual]["kernels"] = getPathsFromRegex(root, category[qual].at("kernels"));
+    for(auto &kernelType : kernelTypes) {
+      // iterate pointers
+      for(auto &pointer : index.find(kernelType)) {
+        json const &category = conf.at(pointer);
+        string instrument = KernelQueryResult::getInstrument(pointer);
 
-        if (category[qual].contains("deps")) {
-          if (category[qual].at("deps").contains("sclk")) {
-            ret[pointer][qual]["deps"]["sclk"] = getPathsFromRegex(root, category[qual].at("deps").at("sclk"));
-          }
-          if (category[qual].at("deps").contains("pck")) {
-            ret[pointer][qual]["deps"]["pck"] = getPathsFromRegex(root, category[qual].at("deps").at("pck"));
-          }
-          if (category[qual].at("deps").contains("objs")) {
-            ret[pointer][qual]["deps"]["objs"] = category[qual].at("deps").at("objs");
+        bool hasDeps = category.contains("deps") && (category.at("deps").contains("sclk") ||
+                                                      category.at("deps").contains("pck") ||
+                                                      category.at("deps").contains("objs"));
+        if (category.contains("kernels") || hasDeps) {
+          addList(ret.at(instrument, kernelType), category, category.contains("kernels"));
+        }
+
+        // iterate over potential qualities
+        for(auto qual: Kernel::QUALITIES) {
+          if(!category.contains(qual)) {
+            continue;
           }
+
+          addList(ret.at(instrument, kernelType, qual), category.at(qual), true);
+        }
+      }
+    }
+
+    vector<vector<string>> paths = PatternSet::get(patterns)->glob(files, filenameOnly);
+    for (size_t i = 0; i < targets.size(); i++) {
+      // interned once here, everything downstream passes handles
+      targets[i]->emplace(paths[i].begin(), paths[i].end());
+    }
+
+    return ret;
+  }
+
+
+  /**
+    * @brief Reduce a list of kernels to the ones with coverage at the given times
+    *
+    * @param kernels binary kernels, each is listed once in its original order
+    * @param times sorted times
+    * @param isContiguous if true, kernels have to cover all of the times
+   **/
+  static vector<KernelPath> filterKernelsByTime(vector<KernelPath> const &kernels, vector<double> const &times, bool isContiguous) {
+    CoverageIndex index(kernels);
+    return index.query(times, isContiguous);
+  }
+
+
+  json globKernels(string root, json conf, string kernelType) {
+    vector<string> files = ls(root, true);
+    return globKernels(files, conf, kernelType);
+  }
+
+
+  json globKernels(vector<string> const &files, json conf, string kernelType) {
+    return globKernelTypes(files, conf, {kernelType}).toJson();
+  }
+
+
+  /**
+    * @brief Get the inventory types that files matching the kernel types can have
+    *
+    * Inventory types are guessed from the directory or the extension, so the same kind
+    * of file can be listed under a related type, e.g. text PCKs are .tf files and the
+    * base tspks are in spk directories. Config deps can add SCLKs and PCKs to any type,
+    * and files whose type couldn't be guessed always have to be searched.
+    *
+    * @param kernelTypes kernel types being searched for
+    * @returns inventory types to search
+   **/
+  static vector<string> getInventoryTypes(vector<string> const &kernelTypes) {
+    static const map<string, vector<string>> related = {
+      {"spk", {"spk", "tspk"}}, {"tspk", {"tspk", "spk"}}, {"ik", {"ik", "iak"}},
+      {"iak", {"iak", "ik"}}
+    };
+
+    // deps can be SCLKs or PCKs, and text PCKs can be listed as FKs
+    vector<string> types = {"na", "sclk", "pck", "fk"};
+    for (auto &kernelType : kernelTypes) {
+      auto it = related.find(kernelType);
+      vector<string> const &add = it != related.end() ? it->second : vector<string>({kernelType});
+
+      for (auto &type : add) {
+        if (find(types.begin(), types.end(), type) == types.end()) {
+          types.emplace_back(type);
         }
       }
     }
+    return types;
+  }
 
-    return  ret.empty() ? "{}"_json : ret;
+
+  json globKernels(KernelInventory const &inventory, json conf, string kernelType, vector<string> const &missions) {
+    return globKernels(inventory.getPaths(getInventoryTypes({kernelType}), missions), conf, kernelType);
   }
 
 
   json searchMissionKernels(string root, json conf) {
-    json kernels;
+    return queryMissionKernels(root, conf).toJson();
+  }
 
-    // the kernels group is now the conf with
-    for(auto &kernelType: {"ck", "spk", "tspk", "fk", "ik", "iak", "pck", "lsk", "sclk"}) {
-        kernels.merge_patch(globKernels(root, conf, kernelType));
+
+  json searchMissionKernels(vector<string> const &files, json conf) {
+    return queryMissionKernels(files, conf).toJson();
+  }
+
+
+  KernelQueryResult queryMissionKernels(string root, json const &conf) {
+    // walk the tree once and share the listing between every kernel type
+    vector<string> files = ls(root, true);
+    return queryMissionKernels(files, conf);
+  }
+
+
+  KernelQueryResult queryMissionKernels(vector<string> const &files, json const &conf) {
+    // every kernel type is matched in the same pass over the files
+    return globKernelTypes(files, conf, SEARCH_TYPES);
+  }
+
+
+  vector<string> getKernelDirectories(string root, json conf, vector<string> missions) {
+    // only the types the config has patterns for need to be searched
+    JsonKeyIndex index(conf);
+    vector<string> kernelTypes;
+    for (auto &kernelType : SEARCH_TYPES) {
+      if (index.contains(kernelType)) {
+        kernelTypes.emplace_back(kernelType);
+      }
     }
-    return kernels;
+
+    vector<string> dirs;
+    bool foundMission = false;
+    for (auto &mission : missions) {
+      fs::path missionDir = fs::path(root) / mission;
+
+      if (!fs::is_directory(missionDir)) {
+        missionDir = fs::path(root) / toLower(mission);
+      }
+
+      if (!fs::is_directory(missionDir)) {
+        // not in this data area, the other missions can still be pruned
+        continue;
+      }
+      foundMission = true;
+
+      if (!fs::is_directory(missionDir / "kernels")) {
+        dirs.emplace_back(missionDir);
+        continue;
+      }
+
+      for (auto &kernelType : kernelTypes) {
+        fs::path typeDir = missionDir / "kernels" / kernelType;
+        if (fs::is_directory(typeDir) && find(dirs.begin(), dirs.end(), typeDir) == dirs.end()) {
+          dirs.emplace_back(typeDir);
+        }
+      }
+    }
+
+    // none of the missions are laid out like we expect, so nothing can be pruned
+    if (!foundMission) {
+      return {root};
+    }
+    return dirs;
+  }
+
+
+  json searchMissionDirectories(string root, json conf, vector<string> missions) {
+    vector<string> files;
+
+    for (auto &dir : getKernelDirectories(root, conf, missions)) {
+      vector<string> dirFiles = ls(dir, true);
+      files.insert(files.end(), dirFiles.begin(), dirFiles.end());
+    }
+
+    return globKernelTypes(files, conf, SEARCH_TYPES, true).toJson();
+  }
+
+
+  json searchMissionKernels(KernelInventory const &inventory, json conf, vector<string> const &missions) {
+    // nearly every type is searched, without missions the cached listing is used as is
+    if (missions.empty()) {
+      return searchMissionKernels(inventory.getPaths(), conf);
+    }
+    return searchMissionKernels(inventory.getPaths(getInventoryTypes(SEARCH_TYPES), missions), conf);
   }
 
 
@@ -235,6 +396,9 @@ namespace SpiceQL {
 
     json reducedKernels;
 
+    // sorted once here instead of for every instrument/quality
+    sort(times.begin(), times.end());
+
     vector<json::json_pointer> ckpointers = findKeyInJson(kernels, "ck", true);
     vector<json::json_pointer> spkpointers = findKeyInJson(kernels, "spk", true);
     vector<json::json_pointer> pointers(ckpointers.size() + spkpointers.size());
@@ -255,21 +419,9 @@ namespace SpiceQL {
         }
 
         json ckQual = cks[qual]["kernels"];
-        newKernels = json::array();
 
-        for(auto &kernel : ckQual) {
-          vector<pair<double, double>> intervals = getTimeIntervals(kernel);
-          for(auto &interval : intervals) {
-            auto isInRange = [&interval](double d) -> bool {return d >= interval.first && d <= interval.second;};
-
-            if (isContiguous && all_of(times.cbegin(), times.cend(), isInRange)) {
-              newKernels.push_back(kernel);
-            }
-            else if (any_of(times.cbegin(), times.cend(), isInRange)) {
-              newKernels.push_back(kernel);
-            }
-          } // end of searching intervals
-        } // end  of searching kernels
+        // each kernel is listed once, in its original order, no matter how many of its intervals match
+        newKernels = filterKernelsByTime(ckQual.is_null() ? vector<KernelPath>() : jsonArrayToPaths(ckQual), times, isContiguous);
 
         reducedKernels[p/qual/"kernels"] = newKernels;
         reducedKernels[p]["deps"] = kernels[p]["deps"];
@@ -279,6 +431,53 @@ namespace SpiceQL {
     return kernels;
   }
 
+
+  KernelQueryResult queryMissionKernels(KernelQueryResult kernels, vector<double> times, bool isContiguous) {
+    sort(times.begin(), times.end());
+
+    for (auto &[instrument, types] : kernels.instruments) {
+      for (auto &[type, qualities] : types) {
+        if (type != "ck" && type != "spk") {
+          continue;
+        }
+
+        for (auto &[quality, list] : qualities) {
+          if (quality.empty()) {
+            continue;
+          }
+          list.kernels = filterKernelsByTime(list.kernels.value_or(vector<KernelPath>()), times, isContiguous);
+        }
+      }
+    }
+    return kernels;
+  }
+
+
+  KernelQueryResult getLatestKernels(KernelQueryResult kernels) {
+    auto latest = [](optional<vector<KernelPath>> &list) {
+      if (list && !list->empty()) {
+        *list = {getLatestKernel(vector<string>(list->begin(), list->end()))};
+      }
+    };
+
+    // same kernel types as the json version
+    static const set<string> latestTypes = {"ck", "spk", "tspk", "fk", "ik", "iak", "pck", "lsk", "sclk"};
+
+    for (auto &[instrument, types] : kernels.instruments) {
+      for (auto &[type, qualities] : types) {
+        for (auto &[quality, list] : qualities) {
+          if (latestTypes.contains(type)) {
+            latest(list.kernels);
+          }
+          // sclk deps are kernel lists too
+          latest(list.sclk);
+        }
+      }
+    }
+    return kernels;
+  }
+
+
   json searchMissionKernels(json conf) {
     fs::path root = getDataDirectory();
     return searchMissionKernels(root, conf);
@@ -0,0 +1,164 @@
+/**
+  * @file
+  *
+  *
+ **/
+
+#include "results.h"
+#include "spice_types.h"
+#include "utils.h"
+
+using json = nlohmann::json;
+using namespace std;
+
+namespace SpiceQL {
+
+  /**
+   * @brief Write a kernel list into the json object for its kernel type or quality
+   **/
+  static void listToJson(KernelList const &list, json &node) {
+    if (list.kernels) {
+      node["kernels"] = *list.kernels;
+    }
+    if (list.sclk) {
+      node["deps"]["sclk"] = *list.sclk;
+    }
+    if (list.pck) {
+      node["deps"]["pck"] = *list.pck;
+    }
+    if (list.objs) {
+      node["deps"]["objs"] = *list.objs;
+    }
+  }
+
+
+  /**
+   * @brief Read a kernel list from the json object for its kernel type or quality
+   *
+   * @return true if the object had anything in it
+   **/
+  static bool listFromJson(json const &node, KernelList &list) {
+    if (node.contains("kernels")) {
+      list.kernels = node.at("kernels").is_null() ? vector<KernelPath>() : jsonArrayToPaths(node.at("kernels"));
+    }
+
+    if (node.contains("deps") && node.at("deps").is_object()) {
+      json const &deps = node.at("deps");
+      if (deps.contains("sclk")) {
+        list.sclk = jsonArrayToPaths(deps.at("sclk"));
+      }
+      if (deps.contains("pck")) {
+        list.pck = jsonArrayToPaths(deps.at("pck"));
+      }
+      if (deps.contains("objs")) {
+        list.objs = jsonArrayToVector(deps.at("objs"));
+      }
+    }
+    return list.kernels || list.sclk || list.pck || list.objs;
+  }
+
+
+  KernelList &KernelQueryResult::at(string const &instrument, string const &type, string const &quality) {
+    return instruments[instrument][type][quality];
+  }
+
+
+  const KernelList *KernelQueryResult::find(string const &instrument, string const &type, string const &quality) const {
+    auto instrumentIt = instruments.find(instrument);
+    if (instrumentIt == instruments.end()) {
+      return nullptr;
+    }
+
+    auto typeIt = instrumentIt->second.find(type);
+    if (typeIt == instrumentIt->second.end()) {
+      return nullptr;
+    }
+
+    auto qualityIt = typeIt->second.find(quality);
+    return qualityIt != typeIt->second.end() ? &qualityIt->second : nullptr;
+  }
+
+
+  vector<KernelPath> KernelQueryResult::getKernels() const {
+    vector<KernelPath> kernels;
+
+    for (auto &[instrument, types] : instruments) {
+      for (auto &[type, qualities] : types) {
+        for (auto &[quality, list] : qualities) {
+          if (list.kernels) {
+            kernels.insert(kernels.end(), list.kernels->begin(), list.kernels->end());
+          }
+        }
+      }
+    }
+    return kernels;
+  }
+
+
+  string KernelQueryResult::getPointer(string const &instrument, string const &type, string const &quality) {
+    string pointer = instrument.empty() ? "" : "/" + instrument;
+    pointer += "/" + type;
+    if (!quality.empty()) {
+      pointer += "/" + quality;
+    }
+    return pointer + "/kernels";
+  }
+
+
+  string KernelQueryResult::getInstrument(json::json_pointer const &typePointer) {
+    string instrument = typePointer.parent_pointer().to_string();
+    return instrument.empty() ? instrument : instrument.substr(1);
+  }
+
+
+  json KernelQueryResult::toJson() const {
+    json ret = json::object();
+
+    for (auto &[instrument, types] : instruments) {
+      json &instrumentNode = instrument.empty() ? ret : ret[json::json_pointer("/" + instrument)];
+
+      for (auto &[type, qualities] : types) {
+        json &typeNode = instrumentNode[type];
+
+        for (auto &[quality, list] : qualities) {
+          listToJson(list, quality.empty() ? typeNode : typeNode[quality]);
+        }
+      }
+    }
+    return ret;
+  }
+
+
+  KernelQueryResult KernelQueryResult::fromJson(json const &kernels) {
+    KernelQueryResult res;
+    JsonKeyIndex index(kernels);
+
+    for (auto &type : Kernel::TYPES) {
+      // "na" is a quality
+      if (type == "na") {
+        continue;
+      }
+
+      for (auto &pointer : index.find(type)) {
+        json const &category = kernels.at(pointer);
+        if (!category.is_object()) {
+          continue;
+        }
+
+        string instrument = getInstrument(pointer);
+        KernelList list;
+        if (listFromJson(category, list)) {
+          res.at(instrument, type) = list;
+        }
+
+        for (auto &quality : Kernel::QUALITIES) {
+          KernelList qualityList;
+          if (category.contains(quality) && listFromJson(category.at(quality), qualityList)) {
+            res.at(instrument, type, quality) = qualityList;
+          }
+        }
+      }
+    }
+    return res;
+  }
+}
@@ -4,6 +4,17 @@
   *
  **/
 
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <fmt/format.h>
 #include <SpiceUsr.h>
 
@@ -11,6 +22,8 @@
 
 #include <ghc/fs_std.hpp>
 
+#include "config.h"
+#include "daf.h"
 #include "spice_types.h"
 #include "query.h"
 #include "utils.h"
@@ -107,9 +120,9 @@ namespace SpiceQL {
   }
 
 
-  Kernel::Kernel(string path) {
+  Kernel::Kernel(KernelPath path, bool priority) {
     this->path = path;
-    KernelPool::getInstance().load(path, true);
+    KernelPool::getInstance().load(path, priority);
   }
 
 
@@ -124,67 +137,394 @@ namespace SpiceQL {
   }
 
 
+  //! DAFs are made of fixed size records
+  static const size_t DAF_RECORD_SIZE = 1024;
+
+
+  /**
+   * @brief Strip trailing blanks from a fixed length Fortran string
+   **/
+  static string trimRight(string s) {
+    s.erase(s.find_last_not_of(" \0", string::npos, 2) + 1);
+    return s;
+  }
+
+
+  MappedKernel::MappedKernel(string path) : path(path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw runtime_error("Could not open " + path + ": " + strerror(errno));
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 8) {
+      close(fd);
+      throw invalid_argument(path + " is not a DAF");
+    }
+
+    size = st.st_size;
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (mapped == MAP_FAILED) {
+      throw runtime_error("Could not map " + path + ": " + strerror(errno));
+    }
+    data = static_cast<unsigned char *>(mapped);
+
+    // the file record is the first record
+    idWord = trimRight(string(reinterpret_cast<char *>(data), 8));
+
+    if (idWord.rfind("DAF/", 0) != 0) {
+      munmap(data, size);
+      throw invalid_argument(path + " is not a DAF, ID word is \"" + idWord + "\"");
+    }
+
+    if (size < DAF_RECORD_SIZE) {
+      munmap(data, size);
+      throw runtime_error(path + " is truncated");
+    }
+
+    string locfmt = trimRight(string(reinterpret_cast<char *>(data) + 88, 8));
+
+    // files older than N0050 have no format string and are in the native format
+    bool bigEndian = endian::native == endian::big;
+    if (locfmt == "BIG-IEEE") {
+      swap = !bigEndian;
+    }
+    else if (locfmt == "LTL-IEEE") {
+      swap = bigEndian;
+    }
+    else if (!locfmt.empty()) {
+      munmap(data, size);
+      throw invalid_argument(path + " has unsupported binary format " + locfmt);
+    }
+
+    nd = readInt(8);
+    ni = readInt(12);
+    fward = readInt(76);
+
+    // summaries have to fit in a record after the three control words
+    if (nd < 0 || ni < 2 || nd + (ni + 1) / 2 > 125 || fward < 2) {
+      munmap(data, size);
+      throw runtime_error(path + " has a corrupt file record");
+    }
+  }
+
+
+  MappedKernel::~MappedKernel() {
+    munmap(data, size);
+  }
+
+
+  string MappedKernel::getKernelType() const {
+    return idWord.substr(4);
+  }
+
+
+  int MappedKernel::getND() const {
+    return nd;
+  }
+
+
+  int MappedKernel::getNI() const {
+    return ni;
+  }
+
+
+  vector<DafSummary> MappedKernel::getSummaries() const {
+    vector<DafSummary> summaries;
+
+    // size of a summary in doubles
+    size_t ss = nd + (ni + 1) / 2;
+    size_t nrecords = size / DAF_RECORD_SIZE;
+    size_t record = fward;
+
+    // summary records form a linked list, the count guards against loops in corrupt files
+    for (size_t visited = 0; record != 0; visited++) {
+      if (record > nrecords || visited > nrecords) {
+        throw runtime_error(path + " has a corrupt summary record list");
+      }
+
+      size_t offset = (record - 1) * DAF_RECORD_SIZE;
+      size_t next = static_cast<size_t>(readDouble(offset));
+      size_t nsum = static_cast<size_t>(readDouble(offset + 16));
+
+      if (nsum > (DAF_RECORD_SIZE / 8 - 3) / ss) {
+        throw runtime_error(path + " has a corrupt summary record");
+      }
+
+      for (size_t i = 0; i < nsum; i++) {
+        size_t start = offset + (3 + i * ss) * 8;
+        DafSummary summary;
+
+        for (int d = 0; d < nd; d++) {
+          summary.doubles.emplace_back(readDouble(start + d * 8));
+        }
+
+        for (int n = 0; n < ni; n++) {
+          summary.ints.emplace_back(readInt(start + nd * 8 + n * 4));
+        }
+
+        summaries.emplace_back(move(summary));
+      }
+
+      record = next;
+    }
+
+    return summaries;
+  }
+
+
+  bool MappedKernel::isNativeByteOrder() const {
+    return !swap;
+  }
+
+
+  span<const double> MappedKernel::getData(int begin, int end) const {
+    if (swap) {
+      throw logic_error(path + " is not in this machine's byte order, use readData instead");
+    }
+
+    checkAddresses(begin, end);
+    return span<const double>(reinterpret_cast<const double *>(data) + (begin - 1), end - begin + 1);
+  }
+
+
+  vector<double> MappedKernel::readData(int begin, int end) const {
+    checkAddresses(begin, end);
+
+    vector<double> res;
+    res.reserve(end - begin + 1);
+    for (int address = begin; address <= end; address++) {
+      res.emplace_back(readDouble((address - 1) * 8));
+    }
+    return res;
+  }
+
+
+  void MappedKernel::checkAddresses(int begin, int end) const {
+    if (begin < 1 || end < begin - 1 || static_cast<size_t>(end) * 8 > size) {
+      throw out_of_range(fmt::format("Addresses {} to {} are outside of {}", begin, end, path));
+    }
+  }
+
+
+  double MappedKernel::readDouble(size_t offset) const {
+    if (offset + 8 > size) {
+      throw runtime_error(path + " is truncated");
+    }
+
+    unsigned char bytes[8];
+    memcpy(bytes, data + offset, 8);
+    if (swap) {
+      reverse(begin(bytes), end(bytes));
+    }
+
+    double d;
+    memcpy(&d, bytes, 8);
+    return d;
+  }
+
+
+  int32_t MappedKernel::readInt(size_t offset) const {
+    if (offset + 4 > size) {
+      throw runtime_error(path + " is truncated");
+    }
+
+    unsigned char bytes[4];
+    memcpy(bytes, data + offset, 4);
+    if (swap) {
+      reverse(begin(bytes), end(bytes));
+    }
+
+    int32_t i;
+    memcpy(&i, bytes, 4);
+    return i;
+  }
+
+
+  TimeConverter &TimeConverter::getInstance() {
+    static TimeConverter converter;
+    return converter;
+  }
+
+
+  TimeConverter::TimeConverter() {
+    KernelPool::getInstance();
+  }
+
+
+  void TimeConverter::pin() {
+    string env;
+    for (const char *var : {"SPICEROOT", "ALESPICEROOT", "ISISDATA"}) {
+      char *ptr = getenv(var);
+      env += ptr == NULL ? "" : ptr;
+      env += '\n';
+    }
+
+    if (lsk && env == environment) {
+      return;
+    }
+
+    json conf = globKernels(getDataDirectory(), *ConfigRegistry::getInstance().getConfig("base"), "lsk");
+    lsk = make_unique<Kernel>(getLatestKernel(conf.at("base").at("lsk").at("kernels")));
+    environment = env;
+  }
+
+
+  double TimeConverter::utcToEt(string const &utc) {
+    lock_guard<mutex> guard(lock);
+    pin();
+
+    SpiceDouble et;
+    utc2et_c(utc.c_str(), &et);
+    return et;
+  }
+
+
+  vector<double> TimeConverter::utcToEt(vector<string> const &utcs) {
+    lock_guard<mutex> guard(lock);
+    pin();
+
+    vector<double> ets(utcs.size());
+    for (size_t i = 0; i < utcs.size(); i++) {
+      utc2et_c(utcs[i].c_str(), &ets[i]);
+    }
+    return ets;
+  }
+
+
+  string TimeConverter::etToUtc(double et, string const &format, int precision) {
+    return etToUtc(vector<double>{et}, format, precision).at(0);
+  }
+
+
+  vector<string> TimeConverter::etToUtc(vector<double> const &ets, string const &format, int precision) {
+    lock_guard<mutex> guard(lock);
+    pin();
+
+    // longest format is "C" or "J" with the decimal places
+    vector<SpiceChar> utc(64 + max(precision, 0));
+    vector<string> utcs(ets.size());
+    for (size_t i = 0; i < ets.size(); i++) {
+      et2utc_c(ets[i], format.c_str(), precision, utc.size(), utc.data());
+      utcs[i] = utc.data();
+    }
+    return utcs;
+  }
+
+
+  string TimeConverter::getLsk() {
+    lock_guard<mutex> guard(lock);
+    pin();
+    return lsk->path;
+  }
+
+
+  void TimeConverter::release() {
+    lock_guard<mutex> guard(lock);
+    lsk.reset();
+  }
+
+
   double utcToEt(string utc) {
-      // get lsk kernel
-      json conf = getMissionConfig("base");
-      conf = globKernels(getDataDirectory(), conf, "lsk");
-      Kernel lsk(getLatestKernel(conf.at("base").at("lsk").at("kernels")));
+    return TimeConverter::getInstance().utcToEt(utc);
+  }
+
+
+  vector<double> utcToEt(vector<string> const &utcs) {
+    return TimeConverter::getInstance().utcToEt(utcs);
+  }
+
+
+  string etToUtc(double et, string const &format, int precision) {
+    return TimeConverter::getInstance().etToUtc(et, format, precision);
+  }
+
 
-      SpiceDouble et;
-      utc2et_c(utc.c_str(), &et);
-      return et;
+  vector<string> etToUtc(vector<double> const &ets, string const &format, int precision) {
+    return TimeConverter::getInstance().etToUtc(ets, format, precision);
   }
 
 
-  int KernelPool::load(string path, bool force_refurnsh) {
-    int refCount; 
+  int KernelPool::load(KernelPath path, bool force_refurnsh) {
+    lock_guard<mutex> guard(lock);
+    int refCount = 1;
 
     auto it = refCounts.find(path);
+    auto retainedIt = retainedIndex.find(path);
 
     if (it != refCounts.end()) {
       // it's been furnished before, increment ref count
       it->second += 1;
       refCount = it->second; 
-
-      if (force_refurnsh) {
-        furnsh_c(path.c_str());
-      } 
+      stats.hits++;
+    }
+    else if (retainedIt != retainedIndex.end()) {
+      // still furnished from before, reuse it
+      retained.erase(retainedIt->second);
+      retainedIndex.erase(retainedIt);
+      refCounts.emplace(path, 1);
+      stats.hits++;
     }
     else {  
       // load the kernel and register in onto the kernel map 
       furnsh_c(path.c_str());
       refCounts.emplace(path, 1);
+      priorities[path] = nextPriority++;
+      stats.misses++;
+      return refCount;
+    }
+
+    if (force_refurnsh) {
+      // CSPICE keeps an entry for every furnsh, so unload first to keep a single copy
+      unload_c(path.c_str());
+      furnsh_c(path.c_str());
+      priorities[path] = nextPriority++;
     }
 
     return refCount;
   }
 
 
-  int KernelPool::unload(string path) {
+  int KernelPool::unload(KernelPath path) {
+    lock_guard<mutex> guard(lock);
+
     try { 
       int &refcount = refCounts.at(path);
       
       // if the map contains the last copy of the kernel, delete it
       if (refcount == 1) {
-        // unfurnsh the kernel
-        unload_c(path.c_str());
         refCounts.erase(path);
+
+        if (capacity > 0) {
+          // keep it furnished in case it's needed again
+          retained.push_front(path);
+          retainedIndex[path] = retained.begin();
+          evict(capacity);
+        }
+        else {
+          // unfurnsh the kernel
+          unload_c(path.c_str());
+          priorities.erase(path);
+        }
         return 0;
       }
       else {
-        unload_c(path.c_str());
         refcount--;
         
         return refcount;
       }
     }
     catch(out_of_range &e) {
-      throw out_of_range(path + " is not a kernel that has been loaded."); 
+      throw out_of_range(path.str() + " is not a kernel that has been loaded."); 
     }
   }
 
 
-  unsigned int KernelPool::getRefCount(std::string key) {
+  unsigned int KernelPool::getRefCount(KernelPath key) {
+    lock_guard<mutex> guard(lock);
+
     try {
       return refCounts.at(key);
     } catch(out_of_range &e) {
@@ -194,7 +534,13 @@ namespace SpiceQL {
 
 
   unordered_map<string, int> KernelPool::getRefCounts() {
-    return refCounts;
+    lock_guard<mutex> guard(lock);
+    unordered_map<string, int> res;
+
+    for (auto &[path, count] : refCounts) {
+      res.emplace(path, count);
+    }
+    return res;
   }
 
 
@@ -205,11 +551,106 @@ namespace SpiceQL {
 
 
   KernelPool::KernelPool() : refCounts() { 
+    char *ptr = getenv("SSPICE_KERNEL_CAPACITY");
+    if (ptr != NULL) {
+      char const *end = ptr + strlen(ptr);
+      size_t value;
+      auto res = from_chars(ptr, end, value);
+
+      // throwing here would fail every Kernel in the process, keep the default instead
+      if (res.ec != errc() || res.ptr != end) {
+        cerr << "Ignoring invalid SSPICE_KERNEL_CAPACITY \"" << ptr << "\", using " << capacity << endl;
+      }
+      else {
+        capacity = value;
+      }
+    }
+
     loadLeapSecondKernel();
   }
 
 
+  void KernelPool::setCapacity(size_t capacity) {
+    lock_guard<mutex> guard(lock);
+    this->capacity = capacity;
+    evict(capacity);
+  }
+
+
+  size_t KernelPool::getCapacity() {
+    lock_guard<mutex> guard(lock);
+    return capacity;
+  }
+
+
+  vector<string> KernelPool::getRetainedKernels() {
+    lock_guard<mutex> guard(lock);
+    return vector<string>(retained.begin(), retained.end());
+  }
+
+
+  KernelPoolStats KernelPool::getStats() {
+    lock_guard<mutex> guard(lock);
+    return stats;
+  }
+
+
+  void KernelPool::resetStats() {
+    lock_guard<mutex> guard(lock);
+    stats = KernelPoolStats();
+  }
+
+
+  vector<string> KernelPool::getFurnishedKernels() {
+    lock_guard<mutex> guard(lock);
+
+    vector<pair<unsigned long, KernelPath>> furnished;
+    for (auto &[path, priority] : priorities) {
+      furnished.emplace_back(priority, path);
+    }
+    sort(furnished.begin(), furnished.end());
+
+    vector<string> res;
+    for (auto &[priority, path] : furnished) {
+      res.emplace_back(path);
+    }
+    return res;
+  }
+
+
+  void KernelPool::clear() {
+    lock_guard<mutex> guard(lock);
+    refCounts.clear();
+    retained.clear();
+    retainedIndex.clear();
+    priorities.clear();
+    nextPriority = 1;
+  }
+
+
+  unsigned long KernelPool::getPriority(KernelPath path) {
+    lock_guard<mutex> guard(lock);
+
+    auto it = priorities.find(path);
+    return it != priorities.end() ? it->second : 0;
+  }
+
+
+  void KernelPool::evict(size_t capacity) {
+    while (retained.size() > capacity) {
+      KernelPath path = retained.back();
+      retained.pop_back();
+      retainedIndex.erase(path);
+
+      unload_c(path.c_str());
+      priorities.erase(path);
+      stats.evictions++;
+    }
+  }
+
+
   vector<string> KernelPool::getLoadedKernels() {
+    lock_guard<mutex> guard(lock);
     vector<string> res;
 
     for( const auto& [key, value] : refCounts ) {
@@ -224,14 +665,13 @@ namespace SpiceQL {
     // if data dir not set, should raise an exception 
     fs::path dataDir = getDataDirectory();
 
-    vector<json> confs = getAvailableConfigs();
     // get SCLKs
-    for(auto &j : confs) {
+    for(auto &conf : ConfigRegistry::getInstance().getConfigs()) {
+      json const &j = *conf;
       vector<json::json_pointer> p = findKeyInJson(j, "sclk", true);
       
       if (!p.empty()) {
-        json sclks = j[p.at(0)];
-        clocks[p.at(0)] = sclks;
+        clocks[p.at(0)] = j.at(p.at(0));
       }
     }
   
@@ -257,20 +697,140 @@ namespace SpiceQL {
   }
 
 
-  KernelSet::KernelSet(json kernels) {
+  /**
+   * @brief Load a kernel so it takes precedence over the kernels loaded before it in a set
+   *
+   * @param path kernel to load
+   * @param last priority of the previous kernel in the set, updated to this kernel's
+   * @return the loaded kernel
+   */
+  static Kernel *loadAfter(KernelPath path, unsigned long &last) {
+    KernelPool &pool = KernelPool::getInstance();
+
+    Kernel *kernel = new Kernel(path, pool.getPriority(path) < last);
+    last = pool.getPriority(path);
+    return kernel;
+  }
+
+
+  KernelSet::KernelSet(json kernels, bool lazy) {
     this->kernels = kernels; 
 
     vector<json::json_pointer> pointers = findKeyInJson(kernels, "kernels", true);
+    vector<pair<string, vector<KernelPath>>> lists;
 
     for(auto &p : pointers) { 
-      json jkernels = kernels[p]; 
+      json const &jkernels = kernels[p]; 
+      lists.emplace_back(p.to_string(), jkernels.is_null() ? vector<KernelPath>() : jsonArrayToPaths(jkernels));
+    } 
+
+    loadLists(lists, lazy);
+  }
+
+
+  KernelSet::KernelSet(KernelQueryResult const &kernels, bool lazy) {
+    this->kernels = kernels.toJson();
+
+    // same order as the pointers to the "kernels" keys in the json
+    vector<pair<string, vector<KernelPath>>> lists;
+    for (auto &[instrument, types] : kernels.instruments) {
+      for (auto &[type, qualities] : types) {
+        for (auto &[quality, list] : qualities) {
+          if (list.kernels) {
+            lists.emplace_back(KernelQueryResult::getPointer(instrument, type, quality), *list.kernels);
+          }
+        }
+      }
+    }
+
+    loadLists(lists, lazy);
+  }
+
+
+  void KernelSet::loadLists(vector<pair<string, vector<KernelPath>>> const &lists, bool lazy) {
+    vector<KernelPath> lazyPaths;
+    unsigned long last = 0;
+
+    for(auto &[p, paths] : lists) { 
       vector<SharedKernel> res; 
-      for(auto & k : jkernels) {
-        SharedKernel sk(new Kernel(k));
+      for(auto & k : paths) {
+        optional<string> type = lazy ? readKernelType(k) : nullopt;
+        if (type == "SPK" || type == "CK") {
+          lazyPaths.emplace_back(k);
+          continue;
+        }
+
+        SharedKernel sk(loadAfter(k, last));
         res.emplace_back(sk);
       }
       loadedKernels.emplace(p, res);
     } 
+
+    // after the text kernels are loaded, CK coverage needs the SCLKs
+    vector<pair<KernelPath, vector<pair<double, double>>>> coverage;
+    coverage.reserve(lazyPaths.size());
+
+    for (auto &path : lazyPaths) {
+      vector<pair<double, double>> &intervals = coverage.emplace_back(path, vector<pair<double, double>>()).second;
+      for (auto &[body, bodyIntervals] : CoverageCache::getInstance().getCoverage(path)) {
+        intervals.insert(intervals.end(), bodyIntervals.begin(), bodyIntervals.end());
+      }
+    }
+
+    // built once, adding the kernels one at a time rebuilds the tree for each of them
+    lazyIndex = CoverageIndex(coverage);
+    lazyKernels.resize(lazyPaths.size());
+  }
+
+
+  void KernelSet::load(double start, double stop) {
+    loadLazy(lazyIndex.query(start, stop));
+  }
+
+
+  void KernelSet::load(vector<double> const &times) {
+    loadLazy(lazyIndex.query(times));
+  }
+
+
+  void KernelSet::loadLazy(vector<KernelPath> const &needed) {
+    vector<KernelPath> const &paths = lazyIndex.getKernels();
+
+    // both lists are in json order
+    vector<bool> isNeeded(paths.size(), false);
+    for (size_t i = 0, j = 0; i < paths.size() && j < needed.size(); i++) {
+      if (paths[i] == needed[j]) {
+        isNeeded[i] = true;
+        j++;
+      }
+    }
+
+    // kernels loaded out of json order are moved up so the priority matches the json
+    unsigned long last = 0;
+    for (size_t i = 0; i < paths.size(); i++) {
+      if (!isNeeded[i]) {
+        lazyKernels[i].reset();
+      }
+      else if (!lazyKernels[i] || KernelPool::getInstance().getPriority(paths[i]) < last) {
+        lazyKernels[i].reset(loadAfter(paths[i], last));
+      }
+      else {
+        last = KernelPool::getInstance().getPriority(paths[i]);
+      }
+    }
+  }
+
+
+  vector<string> KernelSet::getLazyLoadedKernels() const {
+    vector<string> res;
+    vector<KernelPath> const &paths = lazyIndex.getKernels();
+
+    for (size_t i = 0; i < paths.size(); i++) {
+      if (lazyKernels[i]) {
+        res.emplace_back(paths[i]);
+      }
+    }
+    return res;
   }
 
   
@@ -4,9 +4,16 @@
  *
  **/
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <exception>
 #include <fstream>
+#include <limits>
+#include <mutex>
 #include <optional>
+#include <thread>
+#include <unordered_map>
 
 #include <SpiceUsr.h>
 #include <SpiceZfc.h>
@@ -16,6 +23,9 @@
 
 #include <nlohmann/json.hpp>
 
+#include "config.h"
+#include "coverage.h"
+#include "daf.h"
 #include "utils.h"
 #include "spice_types.h"
 
@@ -99,51 +109,114 @@ namespace SpiceQL {
     return {lt, starg};
   }
 
-  targetOrientation getTargetOrientation(double et, int toFrame, int refFrame) {
-    // Much of this function is from ISIS SpiceRotation.cpp
-    SpiceDouble stateCJ[6][6];
-    SpiceDouble CJ_spice[3][3];
-    SpiceDouble av_spice[3];
-    SpiceDouble quat_spice[4];
+  targetStates getTargetStates(span<const double> ets, string target, string observer, string frame, string abcorr) {
+    SpiceInt targetCode, observerCode, frameCode;
+    SpiceBoolean found;
+
+    // resolve names once instead of for every time
+    bods2c_c(target.c_str(), &targetCode, &found);
+    if (!found) {
+      throw invalid_argument("Unknown target: " + target);
+    }
+
+    bods2c_c(observer.c_str(), &observerCode, &found);
+    if (!found) {
+      throw invalid_argument("Unknown observer: " + observer);
+    }
+
+    namfrm_c(frame.c_str(), &frameCode);
+    if (frameCode == 0) {
+      throw invalid_argument("Unknown frame: " + frame);
+    }
 
+    targetStates res;
+    res.n = ets.size();
+    res.data.resize(7 * res.n);
+
+    double *out = res.data.data();
+    size_t n = res.n;
+    SpiceDouble starg[6];
+    SpiceDouble lt;
+
+    for (size_t i = 0; i < n; i++) {
+      spkez_c(targetCode, ets[i], frame.c_str(), abcorr.c_str(), observerCode, starg, &lt);
+
+      for (size_t c = 0; c < 6; c++) {
+        out[c * n + i] = starg[c];
+      }
+      out[targetStates::LT * n + i] = lt;
+    }
+
+    return res;
+  }
+
+
+  targetOrientation getTargetOrientation(double et, int toFrame, int refFrame) {
     array<double,4> quat;
     array<double,3> av;
 
-    bool has_av = true;
+    size_t fallbacks = getTargetOrientations(span<const double>(&et, 1), toFrame, refFrame, quat, av);
 
-    // First try getting the entire state matrix (6x6), which includes CJ and the angular velocity
-    frmchg_((int *) &refFrame, (int *) &toFrame, &et, (doublereal *) stateCJ);
+    if(fallbacks == 0) return {quat, av};
+    return {quat, nullopt};
+  }
 
-    if (!failed_c()) {
-      // Transpose and isolate CJ and av
-      xpose6_c(stateCJ, stateCJ);
-      xf2rav_c(stateCJ, CJ_spice, av_spice);
 
-      // Convert to std::array for output
-      for(int i = 0; i < 3; i++) {
-        av[i] = av_spice[i];
-      }
+  size_t getTargetOrientations(span<const double> ets, int toFrame, int refFrame,
+                               span<double> quats, span<double> avs) {
+    // Much of this function is from ISIS SpiceRotation.cpp
+    bool computeAv = !avs.empty();
 
+    if (quats.size() < 4 * ets.size() || (computeAv && avs.size() < 3 * ets.size())) {
+      throw invalid_argument("Orientation buffers are too small for " + to_string(ets.size()) + " times");
     }
-    else {  // TODO This case is untested
-      // Recompute CJ_spice ignoring av
 
-      reset_c(); // reset frmchg_ failure
+    SpiceDouble stateCJ[6][6];
+    SpiceDouble CJ_spice[3][3];
+    SpiceDouble av_spice[3];
+    SpiceDouble quat_spice[4];
+    size_t fallbacks = 0;
+
+    for (size_t i = 0; i < ets.size(); i++) {
+      SpiceDouble et = ets[i];
+      bool has_av = false;
 
-      refchg_((int *) &refFrame, (int *) &toFrame, &et, (doublereal *) CJ_spice);
-      xpose_c(CJ_spice, CJ_spice);
+      if (computeAv) {
+        // First try getting the entire state matrix (6x6), which includes CJ and the angular velocity
+        frmchg_((int *) &refFrame, (int *) &toFrame, &et, (doublereal *) stateCJ);
 
-      has_av = false;
-    }
+        if (!failed_c()) {
+          // Transpose and isolate CJ and av
+          xpose6_c(stateCJ, stateCJ);
+          xf2rav_c(stateCJ, CJ_spice, av_spice);
+          has_av = true;
+        }
+        else {  // TODO This case is untested
+          reset_c(); // reset frmchg_ failure, only needed for this sample
+          fallbacks++;
+        }
+      }
+
+      if (!has_av) {
+        // Compute CJ_spice ignoring av
+        refchg_((int *) &refFrame, (int *) &toFrame, &et, (doublereal *) CJ_spice);
+        xpose_c(CJ_spice, CJ_spice);
+      }
+
+      if (computeAv) {
+        for (size_t j = 0; j < 3; j++) {
+          avs[3 * i + j] = has_av ? av_spice[j] : numeric_limits<double>::quiet_NaN();
+        }
+      }
 
-    // Translate matrix to std:array quaternion
-    m2q_c(CJ_spice, quat_spice);
-    for(int i = 0; i < 4; i++) {
-      quat[i] = quat_spice[i];
+      // Translate matrix to quaternion
+      m2q_c(CJ_spice, quat_spice);
+      for (size_t j = 0; j < 4; j++) {
+        quats[4 * i + j] = quat_spice[j];
+      }
     }
 
-    if(has_av) return {quat, av};
-    return {quat, nullopt};
+    return fallbacks;
   }
 
 
@@ -272,27 +345,62 @@ namespace SpiceQL {
     return allResults;
   }
 
-  vector<json::json_pointer> findKeyInJson(json in, string key, bool recursive) {
-    function<vector<json::json_pointer>(json::json_pointer, string, vector<json::json_pointer>, bool)> recur = [&recur, &in](json::json_pointer elem, string key, vector<json::json_pointer> vec, bool recursive) -> vector<json::json_pointer> {
-      json e = in[elem];
-      for (auto &it : e.items()) {
-        json::json_pointer pointer = elem/it.key();
-        if (recursive && it.value().is_structured()) {
-          vec = recur(pointer, key, vec, recursive);
-        }
-        if(it.key() == key) {
-          vec.push_back(pointer);
-        }
+  /**
+   * @brief Depth first walk calling the visitor on every key, children before their parent's key
+   **/
+  static void walkJsonKeys(json const &node, json::json_pointer &pointer, bool recursive,
+                           function<void(string const &, json::json_pointer const &, json const &)> const &visitor) {
+    for (auto &it : node.items()) {
+      pointer.push_back(it.key());
+      if (recursive && it.value().is_structured()) {
+        walkJsonKeys(it.value(), pointer, recursive, visitor);
       }
-      return vec;
-    };
+      visitor(it.key(), pointer, it.value());
+      pointer.pop_back();
+    }
+  }
 
+
+  void visitKeyInJson(json const &in, string const &key,
+                      function<void(json::json_pointer const &, json const &)> const &visitor, bool recursive) {
+    json::json_pointer pointer;
+    walkJsonKeys(in, pointer, recursive, [&](string const &k, json::json_pointer const &p, json const &value) {
+      if (k == key) {
+        visitor(p, value);
+      }
+    });
+  }
+
+
+  vector<json::json_pointer> findKeyInJson(json const &in, string const &key, bool recursive) {
     vector<json::json_pointer> res;
-    json::json_pointer p = ""_json_pointer;
-    res = recur(p, key, res, recursive);
+    visitKeyInJson(in, key, [&res](json::json_pointer const &p, json const &) {
+      res.emplace_back(p);
+    }, recursive);
     return res;
   }
 
+
+  JsonKeyIndex::JsonKeyIndex(json const &in) {
+    json::json_pointer pointer;
+    walkJsonKeys(in, pointer, true, [this](string const &k, json::json_pointer const &p, json const &) {
+      index[k].emplace_back(p);
+    });
+  }
+
+
+  vector<json::json_pointer> const &JsonKeyIndex::find(string const &key) const {
+    static const vector<json::json_pointer> empty;
+
+    auto it = index.find(key);
+    return it != index.end() ? it->second : empty;
+  }
+
+
+  bool JsonKeyIndex::contains(string const &key) const {
+    return index.find(key) != index.end();
+  }
+
   vector<string> jsonArrayToVector(json arr) {
     vector<string> res;
 
@@ -315,28 +423,218 @@ namespace SpiceQL {
   vector<string> ls(string const & root, bool recursive) {
     vector<string> paths;
 
-    if (fs::exists(root) && fs::is_directory(root)) {
-      for (auto i = fs::recursive_directory_iterator(root); i != fs::recursive_directory_iterator(); ++i ) {
-        if (fs::exists(*i)) {
-          paths.emplace_back(i->path());
+    walk(root, [&](vector<string> &batch) {
+      paths.insert(paths.end(), make_move_iterator(batch.begin()), make_move_iterator(batch.end()));
+    }, recursive);
+
+    // walk's output order depends on thread scheduling
+    sort(paths.begin(), paths.end());
+    return paths;
+  }
+
+
+  /**
+   * @brief Queue of directories waiting to be listed by one of walk's threads
+   */
+  struct WalkQueue {
+    mutex lock;
+    deque<fs::path> dirs;
+  };
+
+
+  void walk(string const & root, function<void(vector<string> &)> const & callback, bool recursive, unsigned int nthreads) {
+    static const size_t batchSize = 1024;
+    // listing is mostly waiting on the file system, more threads than this don't help
+    static const unsigned int defaultMaxThreads = 8;
+
+    if (!fs::exists(root) || !fs::is_directory(root)) {
+      return;
+    }
+
+    if (!recursive) {
+      nthreads = 1;
+    }
+    else if (nthreads == 0) {
+      nthreads = clamp(thread::hardware_concurrency(), 1u, defaultMaxThreads);
+    }
+
+    vector<WalkQueue> queues(nthreads);
+
+    // directories that are queued or being listed, the walk is done when this hits zero
+    atomic<size_t> pending = 1;
+    // directories that are queued
+    atomic<size_t> queued = 0;
+    atomic<bool> failed = false;
+    exception_ptr error;
+    mutex callbackLock;
+
+    // threads with nothing to list or steal sleep here until a directory is queued or the walk ends
+    mutex idleLock;
+    condition_variable idle;
+    atomic<size_t> sleeping = 0;
+
+    auto wake = [&](bool all) {
+      // sleepers count themselves before checking for work, so either they see the new work or we see them
+      if (sleeping > 0) {
+        lock_guard<mutex> guard(idleLock);
+        if (all) {
+          idle.notify_all();
+        }
+        else {
+          idle.notify_one();
         }
+      }
+    };
 
-        if(!recursive) {
-          // simply disable recursion if recurse flag is off
-          i.disable_recursion_pending();
+    auto flush = [&](vector<string> &batch) {
+      if (!batch.empty()) {
+        lock_guard<mutex> guard(callbackLock);
+        callback(batch);
+        batch.clear();
+      }
+    };
+
+    // only the first error is kept, everyone stops once one thread fails
+    auto fail = [&](exception_ptr e) {
+      lock_guard<mutex> guard(callbackLock);
+      if (!error) {
+        error = e;
+      }
+      failed = true;
+      wake(true);
+    };
+
+    auto listDirectory = [&](size_t id, fs::path const &dir, vector<string> &batch) {
+      for (auto const &entry : fs::directory_iterator(dir)) {
+        // the file type comes from the directory listing, only symlinks need to be stat'd
+        bool isSymlink = entry.is_symlink();
+        if (isSymlink && !entry.exists()) {
+          continue;
+        }
+
+        batch.emplace_back(entry.path().string());
+
+        if (recursive && !isSymlink && entry.is_directory()) {
+          pending++;
+          {
+            lock_guard<mutex> guard(queues[id].lock);
+            queues[id].dirs.emplace_back(entry.path());
+          }
+          queued++;
+          wake(false);
+        }
+
+        if (batch.size() >= batchSize) {
+          flush(batch);
         }
       }
+    };
+
+    auto worker = [&](size_t id) {
+      vector<string> batch;
+      batch.reserve(batchSize);
+
+      while (pending > 0 && !failed) {
+        optional<fs::path> dir;
+
+        // take the newest directory from our own queue
+        {
+          lock_guard<mutex> guard(queues[id].lock);
+          if (!queues[id].dirs.empty()) {
+            dir = move(queues[id].dirs.back());
+            queues[id].dirs.pop_back();
+            queued--;
+          }
+        }
+
+        // otherwise steal the oldest directory from someone else, it's likely the biggest subtree
+        for (size_t i = 1; !dir && i < nthreads; i++) {
+          WalkQueue &victim = queues[(id + i) % nthreads];
+          lock_guard<mutex> guard(victim.lock);
+          if (!victim.dirs.empty()) {
+            dir = move(victim.dirs.front());
+            victim.dirs.pop_front();
+            queued--;
+          }
+        }
+
+        if (!dir) {
+          unique_lock<mutex> guard(idleLock);
+          sleeping++;
+          idle.wait(guard, [&]() { return queued > 0 || pending == 0 || failed; });
+          sleeping--;
+          continue;
+        }
+
+        try {
+          listDirectory(id, *dir, batch);
+        }
+        catch (...) {
+          fail(current_exception());
+        }
+
+        if (--pending == 0) {
+          wake(true);
+        }
+      }
+
+      try {
+        if (!failed) {
+          flush(batch);
+        }
+      }
+      catch (...) {
+        fail(current_exception());
+      }
+    };
+
+    // list the root first, the other threads are only needed if it has subdirectories
+    vector<string> rootBatch;
+    try {
+      listDirectory(0, root, rootBatch);
+    }
+    catch (...) {
+      fail(current_exception());
+    }
+    pending--;
+
+    try {
+      if (!failed) {
+        flush(rootBatch);
+      }
+    }
+    catch (...) {
+      fail(current_exception());
     }
 
-    return paths;
+    vector<thread> threads;
+    if (pending > 0 && !failed) {
+      for (size_t id = 1; id < nthreads; id++) {
+        threads.emplace_back(worker, id);
+      }
+      worker(0);
+    }
+
+    for (auto &t : threads) {
+      t.join();
+    }
+
+    if (error) {
+      rethrow_exception(error);
+    }
   }
 
 
   vector<string> glob(string const & root, regex const & reg, bool recursive) {
-    vector<string> paths;
     vector<string> files_to_search = ls(root, recursive);
+    return glob(files_to_search, reg);
+  }
 
-    for (auto &f : files_to_search) {
+
+  vector<string> glob(vector<string> const & files, regex const & reg) {
+    vector<string> paths;
+
+    for (auto &f : files) {
       if (regex_search(f.c_str(), reg)) {
         paths.emplace_back(f);
       }
@@ -346,7 +644,188 @@ namespace SpiceQL {
   }
 
 
+  PatternSet::PatternSet(vector<vector<string>> const &groups) : ngroups(groups.size()) {
+    unordered_map<string, size_t> unique;
+
+    for (size_t g = 0; g < groups.size(); g++) {
+      for (auto &pattern : groups[g]) {
+        auto it = unique.find(pattern);
+
+        if (it == unique.end()) {
+          it = unique.emplace(pattern, regexes.size()).first;
+          regexes.emplace_back(pattern);
+          literals.emplace_back(requiredLiteral(pattern));
+          regexGroups.emplace_back();
+        }
+
+        vector<size_t> &regexGroup = regexGroups[it->second];
+        if (regexGroup.empty() || regexGroup.back() != g) {
+          regexGroup.emplace_back(g);
+        }
+      }
+    }
+  }
+
+
+  shared_ptr<const PatternSet> PatternSet::get(vector<vector<string>> const &groups) {
+    static mutex cacheMutex;
+    static unordered_map<string, shared_ptr<const PatternSet>> cache;
+
+    // separators can't show up in the config regexes
+    string key;
+    for (auto &group : groups) {
+      for (auto &pattern : group) {
+        key += pattern + '\x1f';
+      }
+      key += '\x1e';
+    }
+
+    lock_guard<mutex> lock(cacheMutex);
+    auto it = cache.find(key);
+    if (it == cache.end()) {
+      it = cache.emplace(key, make_shared<const PatternSet>(groups)).first;
+    }
+    return it->second;
+  }
+
+
+  vector<size_t> PatternSet::match(string const &path, bool filenameOnly) const {
+    vector<bool> hits(ngroups, false);
+
+    size_t start = 0;
+    if (filenameOnly) {
+      size_t sep = path.find_last_of('/');
+      start = sep == string::npos ? 0 : sep + 1;
+    }
+
+    for (size_t i = 0; i < regexes.size(); i++) {
+      if (!literals[i].empty() && path.find(literals[i], start) == string::npos) {
+        continue;
+      }
+
+      if (regex_search(path.begin() + start, path.end(), regexes[i])) {
+        for (auto g : regexGroups[i]) {
+          hits[g] = true;
+        }
+      }
+    }
+
+    vector<size_t> res;
+    for (size_t g = 0; g < ngroups; g++) {
+      if (hits[g]) {
+        res.emplace_back(g);
+      }
+    }
+    return res;
+  }
+
+
+  vector<vector<string>> PatternSet::glob(vector<string> const &paths, bool filenameOnly) const {
+    vector<vector<string>> res(ngroups);
+
+    for (auto &p : paths) {
+      for (auto g : match(p, filenameOnly)) {
+        res[g].emplace_back(p);
+      }
+    }
+    return res;
+  }
+
+
+  string PatternSet::requiredLiteral(string const &pattern) {
+    if (pattern.find_first_of("|()") != string::npos) {
+      return "";
+    }
+
+    string best, current;
+    size_t i = 0;
+
+    while (i < pattern.size()) {
+      char c = pattern[i];
+      bool literal = true;
+      string atom;
+
+      // find the extent of the next atom
+      if (c == '\\' && i+1 < pattern.size()) {
+        literal = ispunct(static_cast<unsigned char>(pattern[i+1]));
+        atom = pattern[i+1];
+        i += 2;
+      }
+      else if (c == '[') {
+        literal = false;
+        i++;
+        if (i < pattern.size() && pattern[i] == '^') i++;
+        if (i < pattern.size() && pattern[i] == ']') i++;
+        while (i < pattern.size() && pattern[i] != ']') {
+          i += pattern[i] == '\\' ? 2 : 1;
+        }
+        i++;
+      }
+      else {
+        literal = string(".^$*+?{}").find(c) == string::npos;
+        atom = c;
+        i++;
+      }
+
+      // quantified atoms aren't required verbatim, skip the quantifier
+      if (i < pattern.size() && string("*+?{").find(pattern[i]) != string::npos) {
+        literal = false;
+        if (pattern[i] == '{') {
+          i = pattern.find('}', i);
+          i = i == string::npos ? pattern.size() : i;
+        }
+        i++;
+        if (i < pattern.size() && pattern[i] == '?') i++;
+      }
+
+      if (literal) {
+        current += atom;
+      }
+      else {
+        best = current.size() > best.size() ? current : best;
+        current.clear();
+      }
+    }
+
+    return current.size() > best.size() ? current : best;
+  }
+
+
   vector<pair<double, double>> getTimeIntervals(string kpath) {
+    vector<pair<double, double>> result;
+
+    for (auto &[body, times] : CoverageCache::getInstance().getCoverage(kpath)) {
+      //only provide coverage for negative NAIF codes
+      //(Positive codes indicate planetary bodies, negatives indicate
+      // spacecraft and instruments)
+      if (body < 0) {
+        result.insert(result.end(), times.begin(), times.end());
+      }
+    }
+
+    return result;
+  }
+
+
+  map<int, vector<pair<double, double>>> getBodyIntervals(string kpath, bool convertSclk) {
+    optional<string> idType = readKernelType(kpath);
+
+    if (idType == "TEXT" || idType == "META") {
+      throw invalid_argument("Input Kernel is a text kernel which has no intervals");
+    }
+    else if (idType == "SPK" || idType == "CK") {
+      try {
+        return readDafCoverage(kpath, convertSclk);
+      }
+      catch (exception &e) {
+        // e.g. a VAX DAF, let CSPICE read it instead
+      }
+    }
+    else if (idType) {
+      // only SPKs and CKs have body coverage
+      return {};
+    }
+
     auto formatIntervals = [&](SpiceCell &coverage) -> vector<pair<double, double>> {
       //Get the number of intervals in the object.
       int niv = card_c(&coverage) / 2;
@@ -384,8 +863,6 @@ namespace SpiceQL {
     ssize_c(0, &currCell);
     ssize_c(1000, &currCell);
 
-    SPICEDOUBLE_CELL(cover, 200000);
-
     if (currFile == "SPK") {
       spkobj_c(kpath.c_str(), &currCell);
     }
@@ -396,46 +873,33 @@ namespace SpiceQL {
       throw invalid_argument("Input Kernel is a text kernel which has no intervals");
     }
 
-    vector<pair<double, double>> result;
+    map<int, vector<pair<double, double>>> result;
 
     for(int bodyCount = 0 ; bodyCount < card_c(&currCell) ; bodyCount++) {
       //get the NAIF body code
       int body = SPICE_CELL_ELEM_I(&currCell, bodyCount);
 
-      //only provide coverage for negative NAIF codes
-      //(Positive codes indicate planetary bodies, negatives indicate
-      // spacecraft and instruments)
-      if (body < 0) {
-        vector<pair<double, double>> times;
-        //find the correct coverage window
-        if(currFile == "SPK") {
-          SPICEDOUBLE_CELL(cover, 200000);
-          ssize_c(0, &cover);
-          ssize_c(200000, &cover);
-          spkcov_c(kpath.c_str(), body, &cover);
-          times = formatIntervals(cover);
-        }
-        else if(currFile == "CK") {
-          //  200,000 is the max coverage window size for a CK kernel
-          SPICEDOUBLE_CELL(cover, 200000);
-          ssize_c(0, &cover);
-          ssize_c(200000, &cover);
+      //find the correct coverage window
+      if(currFile == "SPK") {
+        SPICEDOUBLE_CELL(cover, 200000);
+        ssize_c(0, &cover);
+        ssize_c(200000, &cover);
+        spkcov_c(kpath.c_str(), body, &cover);
+        result[body] = formatIntervals(cover);
+      }
+      else if(currFile == "CK") {
+        //  200,000 is the max coverage window size for a CK kernel
+        SPICEDOUBLE_CELL(cover, 200000);
+        ssize_c(0, &cover);
+        ssize_c(200000, &cover);
 
-          // A SPICE SEGMENT is composed of SPICE INTERVALS
-          ckcov_c(kpath.c_str(), body, SPICEFALSE, "SEGMENT", 0.0, "TDB", &cover);
+        // A SPICE SEGMENT is composed of SPICE INTERVALS
+        ckcov_c(kpath.c_str(), body, SPICEFALSE, "SEGMENT", 0.0, convertSclk ? "TDB" : "SCLK", &cover);
 
-          times = formatIntervals(cover);
-        }
-
-        result.reserve(result.size() + distance(times.begin(), times.end()));
-        result.insert(result.end(), times.begin(), times.end());
+        result[body] = formatIntervals(cover);
       }
     }
 
-    //for(auto& t: result) {
-    //  cout << fmt::format(FMT_COMPILE("start/stop: {}, {}\n"), t.first, t.second);
-    //}
-
     return result;
   }
 
@@ -485,48 +949,35 @@ namespace SpiceQL {
 
 
   vector<string> getAvailableConfigFiles() {
-    vector<string> confs; 
-    fs::path dbDir = getConfigDirectory();
-    return glob(dbDir, basic_regex("json"), false);
+    return ConfigRegistry::getInstance().getConfigFiles();
   }
 
   vector<json> getAvailableConfigs() {
-    vector<string> confPaths = getAvailableConfigFiles();
     vector<json> confs;
 
-    for(auto & c: confPaths) {
-      ifstream ifs(c);
-      json jf = json::parse(ifs);
-      confs.emplace_back(jf);
+    for(auto & c: ConfigRegistry::getInstance().getConfigs()) {
+      confs.emplace_back(*c);
     }
     return confs; 
   }
 
   string getMissionConfigFile(string mission) {
-  
-    vector<string> paths = getAvailableConfigFiles();
-
-    for(const fs::path &p : paths) {
-      if (p.filename() == fmt::format("{}.json", mission)) {
-        return p;
-      }
-    }
-
-    throw invalid_argument(fmt::format("Config file for \"{}\" not found", mission));
+    return ConfigRegistry::getInstance().getConfigFile(mission);
   }
 
 
   json getMissionConfig(string mission) {
-    fs::path dbPath = getMissionConfigFile(mission);
-
-    ifstream i(dbPath);
-    json conf;
-    i >> conf;
-    return conf;
+    return *ConfigRegistry::getInstance().getConfig(mission);
   }
 
 
   string getKernelType(string kernelPath) {
+    optional<string> idType = readKernelType(kernelPath);
+    if (idType) {
+      return *idType;
+    }
+
+    // no ID word, fall back to letting CSPICE figure it out
     SpiceChar type[6];
     SpiceChar source[6];
     SpiceInt handle;
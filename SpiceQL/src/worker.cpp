@@ -0,0 +1,445 @@
+/**
+  * @file
+  *
+  *
+ **/
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <SpiceUsr.h>
+
+#include "spice_types.h"
+#include "worker.h"
+
+using json = nlohmann::json;
+using namespace std;
+
+namespace SpiceQL {
+
+  SpiceWorker &SpiceWorker::getInstance() {
+    static SpiceWorker worker;
+    return worker;
+  }
+
+
+  SpiceWorker::SpiceWorker() : head(&stub), tail(&stub), stub{nullptr, {nullptr}} {
+    thread = std::thread(&SpiceWorker::run, this);
+  }
+
+
+  SpiceWorker::~SpiceWorker() {
+    stopping = true;
+    signal.fetch_add(1);
+    signal.notify_one();
+    thread.join();
+  }
+
+
+  size_t SpiceWorker::pending() const {
+    return count.load();
+  }
+
+
+  void SpiceWorker::push(Node *node) {
+    count.fetch_add(1);
+
+    // the node is reachable from the previous head once linked, until then the worker
+    // sees the queue as empty and waits for the signal below
+    Node *prev = head.exchange(node, memory_order_acq_rel);
+    prev->next.store(node, memory_order_release);
+
+    signal.fetch_add(1, memory_order_release);
+    signal.notify_one();
+  }
+
+
+  SpiceWorker::Node *SpiceWorker::pop() {
+    Node *last = tail;
+    Node *next = last->next.load(memory_order_acquire);
+
+    if (last == &stub) {
+      if (next == nullptr) {
+        return nullptr;
+      }
+      tail = next;
+      last = next;
+      next = next->next.load(memory_order_acquire);
+    }
+
+    if (next != nullptr) {
+      tail = next;
+      return last;
+    }
+
+    // last is the only node, put the stub behind it so it can be taken
+    if (last != head.load(memory_order_acquire)) {
+      return nullptr;
+    }
+
+    stub.next.store(nullptr, memory_order_relaxed);
+    Node *prev = head.exchange(&stub, memory_order_acq_rel);
+    prev->next.store(&stub, memory_order_release);
+
+    next = last->next.load(memory_order_acquire);
+    if (next != nullptr) {
+      tail = next;
+      return last;
+    }
+    return nullptr;
+  }
+
+
+  void SpiceWorker::run() {
+    while (true) {
+      uint64_t seen = signal.load(memory_order_acquire);
+      Node *node = pop();
+
+      if (node != nullptr) {
+        // exceptions are caught by the packaged_task and end up in the future
+        node->task();
+        delete node;
+        count.fetch_sub(1);
+        continue;
+      }
+
+      if (stopping && count.load() == 0) {
+        break;
+      }
+
+      signal.wait(seen, memory_order_acquire);
+    }
+  }
+
+
+  /**
+   * @brief Send a length prefixed JSON message over a socket
+   *
+   * @returns false if the other end is gone
+   **/
+  static bool sendMessage(int fd, json const &message) {
+    string text = message.dump();
+    uint64_t length = text.size();
+    text.insert(0, reinterpret_cast<char *>(&length), sizeof(length));
+
+    for (size_t sent = 0; sent < text.size();) {
+      ssize_t n = send(fd, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        return false;
+      }
+      sent += n;
+    }
+    return true;
+  }
+
+
+  /**
+   * @brief Receive a length prefixed JSON message from a socket
+   *
+   * @returns the message, or nullopt if the other end is gone
+   **/
+  static optional<json> receiveMessage(int fd) {
+    auto receiveAll = [fd](char *buffer, size_t size) {
+      for (size_t received = 0; received < size;) {
+        ssize_t n = recv(fd, buffer + received, size - received, 0);
+        if (n < 0 && errno == EINTR) {
+          continue;
+        }
+        if (n <= 0) {
+          return false;
+        }
+        received += n;
+      }
+      return true;
+    };
+
+    uint64_t length;
+    if (!receiveAll(reinterpret_cast<char *>(&length), sizeof(length))) {
+      return nullopt;
+    }
+
+    string text(length, '\0');
+    if (!receiveAll(text.data(), length)) {
+      return nullopt;
+    }
+    return json::parse(text);
+  }
+
+
+  /**
+   * @brief Worker process main loop, runs commands until told to quit or the parent goes away
+   **/
+  static void serveWorker(int fd, double *arena, vector<string> const &loaded, json const &kernels) {
+    // files opened by the parent share offsets with it, so everything is reopened. The pool's
+    // bookkeeping is reset too, else kernels it retained look furnished and are never reloaded
+    kclear_c();
+    KernelPool &pool = KernelPool::getInstance();
+    pool.clear();
+
+    // loaded in the parent's load order so overlapping kernels take the same precedence
+    for (auto &path : loaded) {
+      pool.load(path);
+    }
+    KernelSet kernelSet(kernels);
+
+    while (optional<json> command = receiveMessage(fd)) {
+      string cmd = command->at("cmd");
+      if (cmd == "quit") {
+        break;
+      }
+
+      json reply = json::object();
+      try {
+        if (cmd == "states") {
+          size_t n = command->at("n");
+          targetStates states = getTargetStates(span<const double>(arena, n), command->at("target"),
+                                                command->at("observer"), command->at("frame"),
+                                                command->at("abcorr"));
+          copy(states.data.begin(), states.data.end(), arena + n);
+        }
+        else if (cmd == "orientations") {
+          size_t n = command->at("n");
+          bool av = command->at("av");
+          reply["fallbacks"] = getTargetOrientations(span<const double>(arena, n), command->at("toFrame"),
+                                                     command->at("refFrame"), span<double>(arena + n, 4 * n),
+                                                     av ? span<double>(arena + 5 * n, 3 * n) : span<double>());
+        }
+        else if (cmd == "intervals") {
+          json intervals = json::array();
+          for (auto &kernel : command->at("kernels")) {
+            intervals.emplace_back(getTimeIntervals(kernel));
+          }
+          reply["intervals"] = intervals;
+        }
+        else {
+          throw invalid_argument("Unknown worker command " + cmd);
+        }
+      }
+      catch (invalid_argument &e) {
+        reply = {{"error", e.what()}, {"invalid", true}};
+      }
+      catch (exception &e) {
+        reply = {{"error", e.what()}, {"invalid", false}};
+      }
+
+      if (!sendMessage(fd, reply)) {
+        break;
+      }
+    }
+  }
+
+
+  WorkerPool::WorkerPool(json kernels, unsigned nworkers, size_t arenaBytes) : arenaDoubles(arenaBytes / sizeof(double)) {
+    if (nworkers == 0) {
+      nworkers = max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    vector<string> loaded = KernelPool::getInstance().getFurnishedKernels();
+
+    for (unsigned i = 0; i < nworkers; i++) {
+      int fds[2];
+      if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        stop();
+        throw runtime_error(string("Could not create worker socket: ") + strerror(errno));
+      }
+
+      void *arena = mmap(nullptr, arenaDoubles * sizeof(double), PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+      if (arena == MAP_FAILED) {
+        close(fds[0]);
+        close(fds[1]);
+        stop();
+        throw runtime_error(string("Could not map worker arena: ") + strerror(errno));
+      }
+
+      pid_t pid = fork();
+      if (pid < 0) {
+        munmap(arena, arenaDoubles * sizeof(double));
+        close(fds[0]);
+        close(fds[1]);
+        stop();
+        throw runtime_error(string("Could not fork worker: ") + strerror(errno));
+      }
+
+      if (pid == 0) {
+        // the other workers' sockets would keep them alive after the parent exits
+        for (Worker &w : workers) {
+          close(w.fd);
+        }
+        close(fds[0]);
+
+        int status = 0;
+        try {
+          serveWorker(fds[1], static_cast<double *>(arena), loaded, kernels);
+        }
+        catch (exception &e) {
+          cerr << "SpiceQL worker " << getpid() << " failed: " << e.what() << endl;
+          status = 1;
+        }
+
+        // skip the parent's static destructors and atexit handlers
+        _exit(status);
+      }
+
+      close(fds[1]);
+      workers.push_back({pid, fds[0], static_cast<double *>(arena)});
+    }
+  }
+
+
+  WorkerPool::~WorkerPool() {
+    stop();
+  }
+
+
+  void WorkerPool::stop() {
+    for (Worker &w : workers) {
+      sendMessage(w.fd, {{"cmd", "quit"}});
+      close(w.fd);
+    }
+
+    for (Worker &w : workers) {
+      waitpid(w.pid, nullptr, 0);
+      munmap(w.arena, arenaDoubles * sizeof(double));
+    }
+    workers.clear();
+  }
+
+
+  size_t WorkerPool::size() const {
+    return workers.size();
+  }
+
+
+  void WorkerPool::run(size_t n, size_t doublesPerItem,
+                       function<json(double *arena, size_t begin, size_t count)> start,
+                       function<void(double *arena, json const &reply, size_t begin, size_t count)> finish) {
+    lock_guard<mutex> guard(lock);
+
+    size_t perRound = doublesPerItem == 0 ? n : arenaDoubles / doublesPerItem;
+    if (n > 0 && perRound == 0) {
+      throw invalid_argument("Worker arenas are too small");
+    }
+
+    for (size_t begin = 0; begin < n;) {
+      size_t chunk = min(perRound, (n - begin + workers.size() - 1) / workers.size());
+
+      // worker index, first item and number of items for each chunk in this round
+      vector<tuple<size_t, size_t, size_t>> jobs;
+      optional<json> error;
+      for (size_t w = 0; w < workers.size() && begin < n; w++) {
+        size_t count = min(chunk, n - begin);
+        json command = start(workers[w].arena, begin, count);
+
+        if (!sendMessage(workers[w].fd, command)) {
+          // the workers that already got a command are still drained below
+          error = {{"error", "SpiceQL worker " + to_string(workers[w].pid) + " is not running"}, {"invalid", false}};
+          break;
+        }
+        jobs.emplace_back(w, begin, count);
+        begin += count;
+      }
+
+      // wait for every worker before throwing so none are left with a reply pending
+      for (auto &[w, jobBegin, count] : jobs) {
+        optional<json> reply = receiveMessage(workers[w].fd);
+
+        if (!reply) {
+          error = {{"error", "SpiceQL worker " + to_string(workers[w].pid) + " exited"}, {"invalid", false}};
+        }
+        else if (reply->contains("error")) {
+          // a worker that couldn't be reached is reported over a failed query
+          if (!error) {
+            error = reply;
+          }
+        }
+        else if (!error) {
+          finish(workers[w].arena, *reply, jobBegin, count);
+        }
+      }
+
+      if (error) {
+        string message = error->at("error");
+        if (error->at("invalid")) {
+          throw invalid_argument(message);
+        }
+        throw runtime_error(message);
+      }
+    }
+  }
+
+
+  targetStates WorkerPool::getTargetStates(span<const double> ets, string target, string observer, string frame, string abcorr) {
+    targetStates res;
+    res.n = ets.size();
+    res.data.resize(7 * res.n);
+
+    run(ets.size(), 8,
+      [&](double *arena, size_t begin, size_t count) {
+        copy_n(ets.begin() + begin, count, arena);
+        return json({{"cmd", "states"}, {"n", count}, {"target", target}, {"observer", observer},
+                     {"frame", frame}, {"abcorr", abcorr}});
+      },
+      [&](double *arena, json const &, size_t begin, size_t count) {
+        for (size_t c = 0; c < 7; c++) {
+          copy_n(arena + count + c * count, count, res.data.begin() + c * res.n + begin);
+        }
+      });
+
+    return res;
+  }
+
+
+  size_t WorkerPool::getTargetOrientations(span<const double> ets, int toFrame, int refFrame,
+                                           span<double> quats, span<double> avs) {
+    bool computeAv = !avs.empty();
+
+    if (quats.size() < 4 * ets.size() || (computeAv && avs.size() < 3 * ets.size())) {
+      throw invalid_argument("Orientation buffers are too small for " + to_string(ets.size()) + " times");
+    }
+
+    size_t fallbacks = 0;
+    run(ets.size(), 8,
+      [&](double *arena, size_t begin, size_t count) {
+        copy_n(ets.begin() + begin, count, arena);
+        return json({{"cmd", "orientations"}, {"n", count}, {"toFrame", toFrame}, {"refFrame", refFrame},
+                     {"av", computeAv}});
+      },
+      [&](double *arena, json const &reply, size_t begin, size_t count) {
+        copy_n(arena + count, 4 * count, quats.begin() + 4 * begin);
+        if (computeAv) {
+          copy_n(arena + 5 * count, 3 * count, avs.begin() + 3 * begin);
+        }
+        fallbacks += reply.at("fallbacks").get<size_t>();
+      });
+
+    return fallbacks;
+  }
+
+
+  vector<vector<pair<double, double>>> WorkerPool::getTimeIntervals(vector<string> const &kernels) {
+    vector<vector<pair<double, double>>> res(kernels.size());
+
+    run(kernels.size(), 0,
+      [&](double *, size_t begin, size_t count) {
+        json chunk(vector<string>(kernels.begin() + begin, kernels.begin() + begin + count));
+        return json({{"cmd", "intervals"}, {"kernels", chunk}});
+      },
+      [&](double *, json const &reply, size_t begin, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+          res[begin + i] = reply.at("intervals").at(i).get<vector<pair<double, double>>>();
+        }
+      });
+
+    return res;
+  }
+}
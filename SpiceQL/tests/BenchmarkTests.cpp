@@ -0,0 +1,536 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <regex>
+#include <set>
+#include <unordered_map>
+
+#include <gtest/gtest.h>
+
+#include "Fixtures.h"
+
+#include "coverage.h"
+#include "ephemeris.h"
+#include "paths.h"
+#include "query.h"
+#include "spice_types.h"
+#include "utils.h"
+#include "worker.h"
+
+#include "SpiceUsr.h"
+
+using namespace std;
+using namespace SpiceQL;
+using json = nlohmann::json;
+
+// Benchmarks are disabled by default, run them with --gtest_also_run_disabled_tests
+
+
+/**
+ * @brief Time a function in milliseconds
+ */
+template <typename F>
+static double timeMs(F f) {
+  auto start = chrono::steady_clock::now();
+  f();
+  return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+
+TEST_F(TempTestingFiles, DISABLED_BenchmarkLs) {
+  // 50 missions x 10 kernel types x 1000 kernels = 500k files
+  const int nmissions = 50;
+  const int ntypes = 10;
+  const int nkernels = 1000;
+
+  for (int m = 0; m < nmissions; m++) {
+    for (int t = 0; t < ntypes; t++) {
+      fs::path dir = tempDir / ("mission" + to_string(m)) / "kernels" / ("type" + to_string(t));
+      fs::create_directories(dir);
+
+      for (int k = 0; k < nkernels; k++) {
+        ofstream(dir / ("kernel_" + to_string(k) + "_v01.bc"));
+      }
+    }
+  }
+
+  // the old single threaded listing, with a stat for every entry
+  size_t serialCount = 0;
+  double serial = timeMs([&]() {
+    for (auto &entry : fs::recursive_directory_iterator(tempDir)) {
+      if (fs::exists(entry)) {
+        serialCount++;
+      }
+    }
+  });
+
+  vector<string> paths;
+  double parallel = timeMs([&]() { paths = ls(tempDir, true); });
+
+  size_t walkCount = 0;
+  double streamed = timeMs([&]() {
+    walk(tempDir, [&](vector<string> &batch) { walkCount += batch.size(); });
+  });
+
+  cout << "recursive_directory_iterator: " << serial << " ms" << endl;
+  cout << "ls:                           " << parallel << " ms" << endl;
+  cout << "walk:                         " << streamed << " ms" << endl;
+
+  size_t expected = nmissions * (2 + ntypes * (1 + nkernels));
+  EXPECT_EQ(serialCount, expected);
+  EXPECT_EQ(paths.size(), expected);
+  EXPECT_EQ(walkCount, expected);
+}
+
+
+TEST_F(TempTestingFiles, DISABLED_BenchmarkSearchMissionKernelsWalks) {
+  // 20 missions x 9 kernel types x 500 unrelated files, the first 4 missions also have kernels for an instrument
+  const int nmissions = 20;
+  const int nfiller = 500;
+  const int ninstruments = 4;
+  const int nkernels = 10;
+  const vector<string> types = {"ck", "spk", "tspk", "fk", "ik", "iak", "pck", "lsk", "sclk"};
+
+  json conf = json::object();
+  auto addKernels = [&](int i, string type, string name, string ext) {
+    fs::path dir = tempDir / ("mission" + to_string(i)) / "kernels" / type;
+    fs::create_directories(dir);
+    for (int k = 0; k < nkernels; k++) {
+      ofstream(dir / ("inst" + to_string(i) + "_" + name + "_" + to_string(k) + ext));
+    }
+    return "inst" + to_string(i) + "_" + name + "_[0-9]+\\" + ext;
+  };
+
+  for (int i = 0; i < ninstruments; i++) {
+    json &inst = conf["inst" + to_string(i)];
+    string sclk = addKernels(i, "sclk", "clock", ".tsc");
+
+    inst["ck"]["reconstructed"]["kernels"] = addKernels(i, "ck", "ck_r", ".bc");
+    inst["ck"]["smithed"]["kernels"] = addKernels(i, "ck", "ck_s", ".bc");
+    inst["ck"]["deps"]["sclk"] = sclk;
+    inst["spk"]["reconstructed"]["kernels"] = addKernels(i, "spk", "spk_r", ".bsp");
+    inst["spk"]["smithed"]["kernels"] = addKernels(i, "spk", "spk_s", ".bsp");
+    inst["fk"]["kernels"] = addKernels(i, "fk", "frames", ".tf");
+    inst["ik"]["kernels"] = addKernels(i, "ik", "ik", ".ti");
+    inst["iak"]["kernels"] = addKernels(i, "iak", "iak", ".ti");
+    inst["pck"]["kernels"] = addKernels(i, "pck", "pck", ".tpc");
+    inst["sclk"]["kernels"] = sclk;
+  }
+
+  for (int m = 0; m < nmissions; m++) {
+    for (auto &type : types) {
+      fs::path dir = tempDir / ("mission" + to_string(m)) / "kernels" / type;
+      fs::create_directories(dir);
+      for (int k = 0; k < nfiller; k++) {
+        ofstream(dir / ("filler_" + to_string(k) + ".dat"));
+      }
+    }
+  }
+
+  // the old per type globbing, every list of regexes re-walked the root
+  size_t baselineWalks = 0;
+  size_t baselineCount = 0;
+  double baseline = timeMs([&]() {
+    auto globList = [&](json const &regexes) {
+      baselineWalks++;
+      vector<string> files = ls(tempDir, true);
+
+      set<string> matched;
+      for (auto &r : jsonArrayToVector(regexes)) {
+        vector<string> res = glob(files, regex(r));
+        matched.insert(res.begin(), res.end());
+      }
+      baselineCount += matched.size();
+    };
+
+    for (auto &type : types) {
+      for (auto &pointer : findKeyInJson(conf, type, true)) {
+        json const &category = conf.at(pointer);
+
+        if (category.contains("kernels")) {
+          globList(category.at("kernels"));
+        }
+        for (auto &qual : Kernel::QUALITIES) {
+          if (category.contains(qual)) {
+            globList(category.at(qual).at("kernels"));
+          }
+        }
+        if (category.contains("deps") && category.at("deps").contains("sclk")) {
+          globList(category.at("deps").at("sclk"));
+        }
+      }
+    }
+  });
+
+  // what searchMissionKernels(root, conf) does, one walk shared by every list
+  size_t sharedWalks = 0;
+  json res;
+  double shared = timeMs([&]() {
+    sharedWalks++;
+    vector<string> files = ls(tempDir, true);
+    res = searchMissionKernels(files, conf);
+  });
+
+  // every path in the results, deps objs are pointers and don't count
+  function<size_t(json const &)> countPaths = [&](json const &j) -> size_t {
+    size_t count = 0;
+    for (auto &[key, value] : j.items()) {
+      if (value.is_object()) {
+        count += countPaths(value);
+      }
+      else if (key != "objs") {
+        count += value.is_array() ? value.size() : 1;
+      }
+    }
+    return count;
+  };
+
+  cout << "per type globbing:     " << baselineWalks << " walks, " << baseline << " ms" << endl;
+  cout << "shared listing:        " << sharedWalks << " walk, " << shared << " ms" << endl;
+
+  EXPECT_EQ(baselineWalks, ninstruments * 10);
+  EXPECT_EQ(baselineCount, ninstruments * 10 * nkernels);
+  EXPECT_EQ(countPaths(res), baselineCount);
+  EXPECT_EQ(res, searchMissionKernels(tempDir, conf));
+}
+
+
+TEST(BenchmarkTests, DISABLED_BenchmarkCoverageQuery) {
+  // 100k line pushbroom image, 1ms line rate
+  const size_t nlines = 100000;
+  const double startTime = 100000000;
+  vector<double> times(nlines);
+  for (size_t i = 0; i < nlines; i++) {
+    times[i] = startTime + i * 0.001;
+  }
+
+  // 200 kernels with 10 one minute intervals each, spread out over a day around the image
+  const int nkernels = 200;
+  const int nintervals = 10;
+  vector<pair<string, vector<pair<double, double>>>> kernels;
+  CoverageIndex index;
+
+  for (int k = 0; k < nkernels; k++) {
+    vector<pair<double, double>> intervals;
+    for (int i = 0; i < nintervals; i++) {
+      double start = startTime - 43200 + (k * nintervals + i) * 43.2;
+      intervals.push_back({start, start + 60});
+    }
+    kernels.push_back({"kernel" + to_string(k) + ".bc", intervals});
+    index.add(kernels.back().first, intervals);
+  }
+
+  // the old nested loop over kernels x intervals x times
+  vector<KernelPath> naiveAny, naiveContiguous;
+  double naive = timeMs([&]() {
+    for (auto &[kernel, intervals] : kernels) {
+      bool any = false, all = false;
+      for (auto &interval : intervals) {
+        auto isInRange = [&interval](double d) -> bool {return d >= interval.first && d <= interval.second;};
+        any = any || any_of(times.cbegin(), times.cend(), isInRange);
+        all = all || all_of(times.cbegin(), times.cend(), isInRange);
+      }
+      if (any) {
+        naiveAny.push_back(kernel);
+      }
+      if (all) {
+        naiveContiguous.push_back(kernel);
+      }
+    }
+  });
+
+  vector<KernelPath> anyRes, contiguousRes;
+  double indexed = timeMs([&]() {
+    anyRes = index.query(times, false);
+    contiguousRes = index.query(times, true);
+  });
+
+  cout << "nested loops:   " << naive << " ms" << endl;
+  cout << "CoverageIndex:  " << indexed << " ms" << endl;
+
+  EXPECT_EQ(anyRes, naiveAny);
+  EXPECT_EQ(contiguousRes, naiveContiguous);
+  EXPECT_FALSE(anyRes.empty());
+}
+
+
+TEST_F(LroKernelSet, DISABLED_BenchmarkGetTargetStates) {
+  Kernel spk(spkPath1);
+
+  const size_t nepochs = 100000;
+  vector<double> ets(nepochs);
+  for (size_t i = 0; i < nepochs; i++) {
+    ets[i] = 110000000 + i * (10000000.0 / nepochs);
+  }
+
+  vector<targetState> scalarStates;
+  scalarStates.reserve(nepochs);
+  double scalar = timeMs([&]() {
+    for (double et : ets) {
+      scalarStates.emplace_back(getTargetState(et, "-85000", "1"));
+    }
+  });
+
+  targetStates states;
+  double batch = timeMs([&]() { states = getTargetStates(ets, "-85000", "1"); });
+
+  cout << "getTargetState:  " << scalar << " ms" << endl;
+  cout << "getTargetStates: " << batch << " ms" << endl;
+
+  ASSERT_EQ(states.n, nepochs);
+  for (size_t i = 0; i < nepochs; i += nepochs / 10) {
+    EXPECT_DOUBLE_EQ(states.component(targetStates::X)[i], scalarStates[i].starg[0]);
+    EXPECT_DOUBLE_EQ(states.component(targetStates::LT)[i], scalarStates[i].lt);
+  }
+}
+
+
+TEST(BenchmarkTests, DISABLED_BenchmarkFindKeyInJson) {
+  // every mission config merged into one document
+  json merged;
+  for (json &conf : getAvailableConfigs()) {
+    merged.update(conf);
+  }
+
+  vector<string> keys = {"ck", "spk", "tspk", "fk", "ik", "iak", "pck", "lsk", "sclk", "kernels", "deps"};
+  const int nrepeats = 100;
+
+  // the old implementation, copying every subtree it visits
+  function<vector<json::json_pointer>(json::json_pointer, string, vector<json::json_pointer>)> copying =
+    [&copying, &merged](json::json_pointer elem, string key, vector<json::json_pointer> vec) {
+      json e = merged[elem];
+      for (auto &it : e.items()) {
+        json::json_pointer pointer = elem/it.key();
+        if (it.value().is_structured()) {
+          vec = copying(pointer, key, vec);
+        }
+        if (it.key() == key) {
+          vec.push_back(pointer);
+        }
+      }
+      return vec;
+    };
+
+  size_t copyingCount = 0;
+  double copyingMs = timeMs([&]() {
+    for (int i = 0; i < nrepeats; i++) {
+      for (auto &key : keys) {
+        copyingCount += copying(json::json_pointer(), key, {}).size();
+      }
+    }
+  });
+
+  size_t constCount = 0;
+  double constMs = timeMs([&]() {
+    for (int i = 0; i < nrepeats; i++) {
+      for (auto &key : keys) {
+        constCount += findKeyInJson(merged, key, true).size();
+      }
+    }
+  });
+
+  size_t indexCount = 0;
+  double indexMs = timeMs([&]() {
+    for (int i = 0; i < nrepeats; i++) {
+      JsonKeyIndex index(merged);
+      for (auto &key : keys) {
+        indexCount += index.find(key).size();
+      }
+    }
+  });
+
+  cout << "copying findKeyInJson: " << copyingMs << " ms" << endl;
+  cout << "findKeyInJson:         " << constMs << " ms" << endl;
+  cout << "JsonKeyIndex:          " << indexMs << " ms" << endl;
+
+  EXPECT_EQ(constCount, copyingCount);
+  EXPECT_EQ(indexCount, copyingCount);
+  EXPECT_GT(copyingCount, 0);
+}
+
+
+TEST_F(LroKernelSet, DISABLED_BenchmarkRepeatedUtcToEt) {
+  // the LSK stays referenced, like it does while a KernelSet or SCLK conversion is in use
+  Kernel lsk(lskPath);
+  const int ncalls = 10000;
+
+  // every call refurnishing the LSK, which is what loading an already loaded kernel used to do
+  SpiceDouble expected = 0;
+  double refurnished = timeMs([&]() {
+    for (int i = 0; i < ncalls; i++) {
+      Kernel k(lskPath, true);
+      utc2et_c("2016-11-26T22:32:14.582000", &expected);
+    }
+  });
+
+  double et = 0;
+  double counted = timeMs([&]() {
+    for (int i = 0; i < ncalls; i++) {
+      et = utcToEt("2016-11-26T22:32:14.582000");
+    }
+  });
+
+  vector<string> utcs(ncalls, "2016-11-26T22:32:14.582000");
+  vector<double> ets;
+  double batch = timeMs([&]() { ets = utcToEt(utcs); });
+
+  cout << "refurnished:      " << refurnished << " ms" << endl;
+  cout << "utcToEt:          " << counted << " ms" << endl;
+  cout << "utcToEt (vector): " << batch << " ms" << endl;
+
+  EXPECT_DOUBLE_EQ(et, expected);
+  EXPECT_DOUBLE_EQ(ets.back(), expected);
+  TimeConverter::getInstance().release();
+}
+
+
+TEST_F(LroKernelSet, DISABLED_BenchmarkCachedEphemeris) {
+  Kernel spk(spkPath1);
+
+  // a line scan image, one state per line over an hour
+  const size_t nepochs = 100000;
+  vector<double> ets(nepochs);
+  for (size_t i = 0; i < nepochs; i++) {
+    ets[i] = 110000000 + i * (3600.0 / nepochs);
+  }
+
+  targetStates direct;
+  double directMs = timeMs([&]() { direct = getTargetStates(ets, "-85000", "1"); });
+
+  targetStates cached;
+  size_t samples = 0;
+  double maxError = 0;
+  double cachedMs = timeMs([&]() {
+    CachedEphemeris cache("-85000", "1", ets.front(), ets.back(), 10);
+    cached = cache.getStates(ets);
+    samples = cache.getSampleCount();
+    maxError = cache.getMaxError();
+  });
+
+  cout << "getTargetStates: " << directMs << " ms, " << nepochs << " CSPICE calls" << endl;
+  cout << "CachedEphemeris: " << cachedMs << " ms, " << samples << " CSPICE calls, "
+       << maxError << " km max error" << endl;
+
+  ASSERT_EQ(cached.n, nepochs);
+  for (size_t i = 0; i < nepochs; i += nepochs / 10) {
+    EXPECT_NEAR(cached.component(targetStates::X)[i], direct.component(targetStates::X)[i], maxError * 1.01 + 1e-9);
+  }
+}
+
+
+TEST(BenchmarkTests, DISABLED_BenchmarkCachedOrientation) {
+  // J2000 to ECLIPJ2000 is built into SPICE, so this only measures per call overhead
+  const size_t nepochs = 100000;
+  vector<double> ets(nepochs);
+  for (size_t i = 0; i < nepochs; i++) {
+    ets[i] = 110000000 + i * (3600.0 / nepochs);
+  }
+
+  vector<double> directQuats(4 * nepochs);
+  vector<double> directAvs(3 * nepochs);
+  double directMs = timeMs([&]() { getTargetOrientations(ets, 17, 1, directQuats, directAvs); });
+
+  vector<double> quats(4 * nepochs);
+  vector<double> avs(3 * nepochs);
+  double maxError = 0;
+  double cachedMs = timeMs([&]() {
+    CachedOrientation cache(17, 1, ets.front(), ets.back(), 10);
+    cache.getOrientations(ets, quats, avs);
+    maxError = cache.getMaxError();
+  });
+
+  cout << "getTargetOrientations: " << directMs << " ms" << endl;
+  cout << "CachedOrientation:     " << cachedMs << " ms, " << maxError << " rad max error" << endl;
+
+  for (size_t i = 0; i < nepochs; i += nepochs / 10) {
+    EXPECT_NEAR(quats[4 * i], directQuats[4 * i], 1e-12);
+  }
+}
+
+
+TEST_F(LroKernelSet, DISABLED_BenchmarkWorkerPool) {
+  json kernels = {{"spk", {{"kernels", {spkPath1}}}}};
+  Kernel spk(spkPath1);
+
+  const size_t nepochs = 1000000;
+  vector<double> ets(nepochs);
+  for (size_t i = 0; i < nepochs; i++) {
+    ets[i] = 110000000 + i * (10000000.0 / nepochs);
+  }
+
+  targetStates serial;
+  double serialMs = timeMs([&]() { serial = getTargetStates(ets, "-85000", "1"); });
+
+  WorkerPool pool(kernels);
+  targetStates parallel;
+  double parallelMs = timeMs([&]() { parallel = pool.getTargetStates(ets, "-85000", "1"); });
+
+  cout << "getTargetStates:            " << serialMs << " ms" << endl;
+  cout << "WorkerPool::getTargetStates: " << parallelMs << " ms, " << pool.size() << " workers" << endl;
+
+  EXPECT_EQ(parallel.data, serial.data);
+}
+
+
+TEST(BenchmarkTests, DISABLED_BenchmarkInternedPaths) {
+  // a data area's worth of ISIS style kernel paths
+  const int nkernels = 200000;
+  vector<string> strings;
+  for (int i = 0; i < nkernels; i++) {
+    strings.emplace_back("/isis_data/lro/kernels/ck/lrolc_" + to_string(2009181 + i) + "_" + to_string(2009182 + i) + "_v01.bc");
+  }
+  vector<KernelPath> paths(strings.begin(), strings.end());
+
+  // ref count style lookups, once by string and once by handle
+  unordered_map<string, int> stringCounts;
+  unordered_map<KernelPath, int> pathCounts;
+  for (int i = 0; i < nkernels; i++) {
+    stringCounts[strings[i]] = i;
+    pathCounts[paths[i]] = i;
+  }
+
+  const int nrepeats = 10;
+  long stringSum = 0;
+  double stringMs = timeMs([&]() {
+    for (int r = 0; r < nrepeats; r++) {
+      for (auto &s : strings) {
+        stringSum += stringCounts.at(s);
+      }
+    }
+  });
+
+  long pathSum = 0;
+  double pathMs = timeMs([&]() {
+    for (int r = 0; r < nrepeats; r++) {
+      for (auto &p : paths) {
+        pathSum += pathCounts.at(p);
+      }
+    }
+  });
+
+  // copying lists around, like the query results do
+  size_t copied = 0;
+  double stringCopyMs = timeMs([&]() {
+    for (int r = 0; r < nrepeats; r++) {
+      vector<string> copy = strings;
+      copied += copy.size();
+    }
+  });
+
+  double pathCopyMs = timeMs([&]() {
+    for (int r = 0; r < nrepeats; r++) {
+      vector<KernelPath> copy = paths;
+      copied += copy.size();
+    }
+  });
+
+  cout << "string lookups:     " << stringMs << " ms" << endl;
+  cout << "KernelPath lookups: " << pathMs << " ms" << endl;
+  cout << "string copies:      " << stringCopyMs << " ms" << endl;
+  cout << "KernelPath copies:  " << pathCopyMs << " ms" << endl;
+
+  EXPECT_EQ(stringSum, pathSum);
+  EXPECT_EQ(copied, 2 * nrepeats * nkernels);
+}
@@ -0,0 +1,81 @@
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+
+#include <gtest/gtest.h>
+
+#include "Fixtures.h"
+
+#include "config.h"
+#include "utils.h"
+
+using namespace std;
+using namespace SpiceQL;
+using json = nlohmann::json;
+
+
+TEST(ConfigTests, UnitTestConfigRegistryShared) {
+  ConfigRegistry &registry = ConfigRegistry::getInstance();
+
+  // every lookup shares the same parsed config
+  shared_ptr<const json> lro = registry.getConfig("lro");
+  EXPECT_EQ(registry.getConfig("lro"), lro);
+
+  json expected;
+  ifstream(getMissionConfigFile("lro")) >> expected;
+  EXPECT_EQ(*lro, expected);
+  EXPECT_EQ(getMissionConfig("lro"), expected);
+
+  vector<string> files = registry.getConfigFiles();
+  EXPECT_EQ(registry.getConfigs().size(), files.size());
+  EXPECT_EQ(getAvailableConfigFiles(), files);
+
+  EXPECT_THROW(registry.getConfig("not a mission"), invalid_argument);
+}
+
+
+TEST_F(TempTestingFiles, UnitTestConfigRegistryReload) {
+  ConfigRegistry &registry = ConfigRegistry::getInstance();
+
+  // point the config directory at the temp dir
+  char *ptr = getenv("CONDA_PREFIX");
+  string condaPrefix = ptr == NULL ? "" : ptr;
+  bool debug = getenv("SSPICE_DEBUG") != NULL;
+
+  fs::path dbDir = tempDir / "etc" / "SpiceQL" / "db";
+  fs::create_directories(dbDir);
+  ofstream(dbDir / "test.json") << R"({"test": {"version": 1}})";
+
+  setenv("CONDA_PREFIX", tempDir.c_str(), true);
+  unsetenv("SSPICE_DEBUG");
+
+  shared_ptr<const json> conf = registry.getConfig("test");
+  EXPECT_EQ(conf->at("test").at("version"), 1);
+
+  // edits aren't seen until a reload
+  ofstream(dbDir / "test.json") << R"({"test": {"version": 2}})";
+  fs::last_write_time(dbDir / "test.json", fs::last_write_time(dbDir / "test.json") + chrono::seconds(1));
+  EXPECT_EQ(registry.getConfig("test"), conf);
+
+  EXPECT_TRUE(registry.reload());
+  EXPECT_FALSE(registry.reload());
+  EXPECT_EQ(registry.getConfig("test")->at("test").at("version"), 2);
+
+  // configs handed out before the reload are still valid
+  EXPECT_EQ(conf->at("test").at("version"), 1);
+
+  // with auto reload, new files are picked up on the next lookup
+  registry.setAutoReload(true);
+  ofstream(dbDir / "other.json") << R"({"other": {}})";
+  fs::last_write_time(dbDir, fs::last_write_time(dbDir) + chrono::seconds(1));
+  EXPECT_NO_THROW(registry.getConfig("other"));
+  registry.setAutoReload(false);
+
+  setenv("CONDA_PREFIX", condaPrefix.c_str(), true);
+  if (debug) {
+    setenv("SSPICE_DEBUG", "True", true);
+  }
+
+  // back to the original directory
+  EXPECT_THROW(registry.getConfig("test"), invalid_argument);
+}
@@ -0,0 +1,170 @@
+#include <fstream>
+
+#include <gtest/gtest.h>
+
+#include "Fixtures.h"
+
+#include "coverage.h"
+#include "utils.h"
+
+using namespace std;
+using namespace SpiceQL;
+
+
+TEST_F(TempTestingFiles, UnitTestCoverageCache) {
+  CoverageCache &cache = CoverageCache::getInstance();
+  cache.clear();
+
+  // not a real kernel, getCoverage would fail if it tried to open it
+  fs::path kpath = tempDir / "fake.bc";
+  ofstream(kpath) << "not a ck";
+
+  map<int, vector<pair<double, double>>> bodies = {{-85000, {{110000000, 120000000}}},
+                                                   {-85, {{1, 2}, {3, 4}}}};
+  EXPECT_FALSE(cache.find(kpath));
+  cache.insert(kpath, bodies);
+
+  EXPECT_EQ(cache.getCoverage(kpath), bodies);
+  vector<pair<double, double>> expected = {{110000000, 120000000}, {1, 2}, {3, 4}};
+  EXPECT_EQ(getTimeIntervals(kpath), expected);
+
+  // round trip through disk
+  fs::path cachePath = tempDir / "coverage.json";
+  cache.save(cachePath);
+  cache.clear();
+  EXPECT_EQ(cache.size(), 0);
+
+  cache.load(cachePath);
+  EXPECT_EQ(cache.size(), 1);
+  EXPECT_EQ(cache.find(kpath)->bodies, bodies);
+
+  // a changed kernel is no longer in the cache
+  ofstream(kpath, ios::app) << " anymore";
+  EXPECT_FALSE(cache.find(kpath));
+
+  cache.clear();
+}
+
+
+TEST_F(TempTestingFiles, UnitTestCoverageCacheSclk) {
+  CoverageCache &cache = CoverageCache::getInstance();
+  cache.clear();
+
+  fs::path kpath = tempDir / "fake.bc";
+  ofstream(kpath) << "not a ck";
+
+  // encoded SCLK is stored as is and flagged for conversion
+  map<int, vector<pair<double, double>>> ticks = {{-85000, {{1000, 2000}}}};
+  cache.insert(kpath, ticks, true);
+  ASSERT_TRUE(cache.find(kpath));
+  EXPECT_TRUE(cache.find(kpath)->sclk);
+  EXPECT_EQ(cache.find(kpath)->bodies, ticks);
+
+  fs::path cachePath = tempDir / "coverage.json";
+  cache.save(cachePath);
+  cache.clear();
+  cache.load(cachePath);
+  ASSERT_TRUE(cache.find(kpath));
+  EXPECT_TRUE(cache.find(kpath)->sclk);
+  EXPECT_EQ(cache.find(kpath)->bodies, ticks);
+
+  // entries from before CK coverage was cached as SCLK are dropped
+  nlohmann::json old = cache.toJson();
+  old[kpath.string()].erase("sclk");
+  ofstream(cachePath) << old;
+  cache.clear();
+  cache.load(cachePath);
+  EXPECT_FALSE(cache.find(kpath));
+
+  cache.clear();
+}
+
+
+TEST(CoverageTests, UnitTestCoverageIndex) {
+  CoverageIndex index;
+  index.add("a.bc", {{0, 10}, {20, 30}});
+  index.add("b.bc", {{5, 25}});
+  index.add("c.bc", {{40, 50}});
+  index.add("d.bc", {});
+
+  EXPECT_EQ(index.size(), 4);
+  EXPECT_EQ(index.getKernels().size(), 4);
+
+  // stabbing queries, endpoints are inclusive
+  EXPECT_EQ(index.query(0.0), vector<KernelPath>({"a.bc"}));
+  EXPECT_EQ(index.query(7.0), vector<KernelPath>({"a.bc", "b.bc"}));
+  EXPECT_EQ(index.query(15.0), vector<KernelPath>({"b.bc"}));
+  EXPECT_EQ(index.query(50.0), vector<KernelPath>({"c.bc"}));
+  EXPECT_EQ(index.query(35.0), vector<KernelPath>());
+  EXPECT_EQ(index.query(-1.0), vector<KernelPath>());
+
+  // overlap queries
+  EXPECT_EQ(index.query(26.0, 45.0), vector<KernelPath>({"a.bc", "c.bc"}));
+  EXPECT_EQ(index.query(31.0, 39.0), vector<KernelPath>());
+  EXPECT_EQ(index.query(-100.0, 100.0), vector<KernelPath>({"a.bc", "b.bc", "c.bc"}));
+
+  // a kernel matching more than one time is only returned once, in insertion order
+  EXPECT_EQ(index.query(vector<double>({45, 1, 2, 21})), vector<KernelPath>({"a.bc", "b.bc", "c.bc"}));
+  EXPECT_EQ(index.query(vector<double>()), vector<KernelPath>());
+}
+
+
+TEST(CoverageTests, UnitTestCoverageIndexBulk) {
+  vector<pair<KernelPath, vector<pair<double, double>>>> coverage = {{"a.bc", {{0, 10}, {20, 30}}},
+                                                                     {"b.bc", {{5, 25}}},
+                                                                     {"c.bc", {{40, 50}}},
+                                                                     {"d.bc", {}}};
+  CoverageIndex bulk(coverage);
+
+  CoverageIndex added;
+  for (auto &[kernel, intervals] : coverage) {
+    added.add(kernel, intervals);
+  }
+
+  EXPECT_EQ(bulk.size(), added.size());
+  EXPECT_EQ(bulk.getKernels(), added.getKernels());
+
+  for (double t : {-1.0, 0.0, 7.0, 15.0, 25.0, 35.0, 50.0}) {
+    EXPECT_EQ(bulk.query(t), added.query(t));
+  }
+  EXPECT_EQ(bulk.query(26.0, 45.0), vector<KernelPath>({"a.bc", "c.bc"}));
+  EXPECT_EQ(bulk.query(vector<double>({45, 1, 2, 21})), added.query(vector<double>({45, 1, 2, 21})));
+}
+
+
+TEST(CoverageTests, UnitTestCoverageIndexContiguous) {
+  CoverageIndex index;
+  index.add("a.bc", {{0, 10}, {20, 30}});
+  index.add("b.bc", {{5, 25}});
+  index.add("c.bc", {{8, 9}});
+
+  // both of a's intervals have some of the times, but neither has all of them
+  EXPECT_EQ(index.query(vector<double>({6, 22, 8}), false), vector<KernelPath>({"a.bc", "b.bc", "c.bc"}));
+  EXPECT_EQ(index.query(vector<double>({6, 22, 8}), true), vector<KernelPath>({"b.bc"}));
+  EXPECT_EQ(index.query(vector<double>({21, 30}), true), vector<KernelPath>({"a.bc"}));
+
+  // the times fall between c's interval's endpoints
+  EXPECT_EQ(index.query(vector<double>({7.5, 9.5}), false), vector<KernelPath>({"a.bc", "b.bc"}));
+}
+
+
+TEST_F(LroKernelSet, UnitTestCoverageCacheGetTimeIntervals) {
+  CoverageCache &cache = CoverageCache::getInstance();
+  cache.clear();
+
+  vector<pair<double, double>> intervals = getTimeIntervals(ckPath1);
+  ASSERT_TRUE(cache.find(ckPath1));
+
+  // cached as encoded SCLK, converted with the loaded SCLK when read
+  EXPECT_TRUE(cache.find(ckPath1)->sclk);
+  EXPECT_EQ(cache.find(ckPath1)->bodies.at(-85000), getBodyIntervals(ckPath1, false).at(-85000));
+  EXPECT_EQ(cache.getCoverage(ckPath1).at(-85000), getBodyIntervals(ckPath1).at(-85000));
+  EXPECT_EQ(getTimeIntervals(ckPath1), intervals);
+
+  // SPKs are already in ET
+  getTimeIntervals(spkPath1);
+  ASSERT_TRUE(cache.find(spkPath1));
+  EXPECT_FALSE(cache.find(spkPath1)->sclk);
+
+  cache.clear();
+}
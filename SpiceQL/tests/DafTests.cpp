@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+
+#include <gtest/gtest.h>
+
+#include "Fixtures.h"
+
+#include "daf.h"
+#include "spice_types.h"
+#include "utils.h"
+
+using namespace std;
+using namespace SpiceQL;
+
+
+/**
+ * @brief Write a minimal SPK style DAF (ND=2, NI=6) with a single summary record
+ *
+ * Segment data is written to the fourth record, starting at address 385.
+ */
+static void writeTestDaf(fs::path path, string idWord, vector<pair<array<double, 2>, array<int, 6>>> segments,
+                         bool bigEndian, vector<double> data = {}) {
+  vector<char> file(4 * 1024, '\0');
+  bool swap = bigEndian != (endian::native == endian::big);
+
+  auto put = [&](size_t offset, auto value) {
+    char bytes[sizeof(value)];
+    memcpy(bytes, &value, sizeof(value));
+    if (swap) {
+      reverse(begin(bytes), end(bytes));
+    }
+    memcpy(file.data() + offset, bytes, sizeof(value));
+  };
+
+  idWord.resize(8, ' ');
+  memcpy(file.data(), idWord.data(), 8);
+  put(8, int32_t(2));
+  put(12, int32_t(6));
+  put(76, int32_t(2));
+  put(80, int32_t(2));
+  memcpy(file.data() + 88, bigEndian ? "BIG-IEEE" : "LTL-IEEE", 8);
+
+  // summary record
+  put(1024, 0.0);
+  put(1024 + 8, 0.0);
+  put(1024 + 16, double(segments.size()));
+
+  for (size_t i = 0; i < segments.size(); i++) {
+    size_t start = 1024 + (3 + i * 5) * 8;
+    put(start, segments[i].first[0]);
+    put(start + 8, segments[i].first[1]);
+
+    for (size_t j = 0; j < 6; j++) {
+      put(start + 16 + j * 4, int32_t(segments[i].second[j]));
+    }
+  }
+
+  for (size_t i = 0; i < data.size(); i++) {
+    put(3 * 1024 + i * 8, data[i]);
+  }
+
+  ofstream(path, ios::binary).write(file.data(), file.size());
+}
+
+
+TEST_F(TempTestingFiles, UnitTestReadDafCoverage) {
+  vector<pair<array<double, 2>, array<int, 6>>> segments = {
+    {{100, 200}, {-85, 301, 1, 13, 641, 1000}},
+    {{150, 250}, {-85, 301, 1, 13, 1001, 2000}},
+    {{300, 400}, {-85, 301, 1, 13, 2001, 3000}},
+    {{0, 1000}, {301, 399, 1, 2, 3001, 4000}}
+  };
+
+  map<int, vector<pair<double, double>>> expected = {
+    {-85, {{100, 250}, {300, 400}}},
+    {301, {{0, 1000}}}
+  };
+
+  for (bool bigEndian : {true, false}) {
+    fs::path spkPath = tempDir / (bigEndian ? "big.bsp" : "little.bsp");
+    writeTestDaf(spkPath, "DAF/SPK", segments, bigEndian);
+
+    MappedKernel daf(spkPath);
+    EXPECT_EQ(daf.getKernelType(), "SPK");
+    EXPECT_EQ(daf.getND(), 2);
+    EXPECT_EQ(daf.getNI(), 6);
+
+    vector<DafSummary> summaries = daf.getSummaries();
+    ASSERT_EQ(summaries.size(), 4);
+    EXPECT_EQ(summaries[1].doubles, vector<double>({150, 250}));
+    EXPECT_EQ(summaries[1].ints, vector<int>({-85, 301, 1, 13, 1001, 2000}));
+
+    EXPECT_EQ(readDafCoverage(spkPath), expected);
+    EXPECT_EQ(getBodyIntervals(spkPath), expected);
+    EXPECT_EQ(getKernelType(spkPath), "SPK");
+  }
+}
+
+
+TEST_F(TempTestingFiles, UnitTestReadKernelType) {
+  ofstream(tempDir / "frames.tf") << "KPL/FK\n\n\\begindata\n";
+  ofstream(tempDir / "meta.tm") << "KPL/MK\n";
+  ofstream(tempDir / "old.ti") << "\\begindata\n";
+  writeTestDaf(tempDir / "orientation.bc", "DAF/CK", {}, false);
+
+  EXPECT_EQ(readKernelType(tempDir / "frames.tf"), "TEXT");
+  EXPECT_EQ(readKernelType(tempDir / "meta.tm"), "META");
+  EXPECT_EQ(readKernelType(tempDir / "orientation.bc"), "CK");
+  EXPECT_FALSE(readKernelType(tempDir / "old.ti"));
+  EXPECT_FALSE(readKernelType(tempDir / "missing.bc"));
+
+  EXPECT_TRUE(readDafCoverage(tempDir / "orientation.bc").empty());
+
+  // CK times can be read as encoded SCLK without an SCLK loaded
+  writeTestDaf(tempDir / "ticks.bc", "DAF/CK", {{{200, 300}, {-85000, -85, 3, 1, 0, 0}},
+                                               {{100, 250}, {-85000, -85, 3, 1, 0, 0}}}, false);
+  map<int, vector<pair<double, double>>> ticks = {{-85000, {{100, 300}}}};
+  EXPECT_EQ(readDafCoverage(tempDir / "ticks.bc", false), ticks);
+  EXPECT_THROW(MappedKernel(tempDir / "frames.tf"), invalid_argument);
+  EXPECT_THROW(getBodyIntervals(tempDir / "frames.tf"), invalid_argument);
+}
+
+
+TEST_F(TempTestingFiles, UnitTestMappedKernelData) {
+  vector<double> data = {1.5, 2.5, 3.5, 4.5};
+  vector<pair<array<double, 2>, array<int, 6>>> segments = {{{0, 10}, {-85, 301, 1, 13, 385, 388}}};
+
+  fs::path nativePath = tempDir / "native.bsp";
+  fs::path swappedPath = tempDir / "swapped.bsp";
+  bool bigEndian = endian::native == endian::big;
+  writeTestDaf(nativePath, "DAF/SPK", segments, bigEndian, data);
+  writeTestDaf(swappedPath, "DAF/SPK", segments, !bigEndian, data);
+
+  MappedKernel native(nativePath);
+  EXPECT_TRUE(native.isNativeByteOrder());
+
+  DafSummary summary = native.getSummaries().at(0);
+  span<const double> view = native.getData(summary.ints[4], summary.ints[5]);
+  EXPECT_EQ(vector<double>(view.begin(), view.end()), data);
+  EXPECT_EQ(native.getData(386, 386)[0], 2.5);
+  EXPECT_THROW(native.getData(0, 2), out_of_range);
+  EXPECT_THROW(native.getData(385, 1000), out_of_range);
+
+  MappedKernel swapped(swappedPath);
+  EXPECT_FALSE(swapped.isNativeByteOrder());
+  EXPECT_THROW(swapped.getData(385, 388), logic_error);
+  EXPECT_EQ(swapped.readData(385, 388), data);
+}
+
+
+TEST_F(LroKernelSet, UnitTestReadDafCoverageSpk) {
+  map<int, vector<pair<double, double>>> coverage = readDafCoverage(spkPath1);
+
+  ASSERT_EQ(coverage.at(-85000).size(), 1);
+  EXPECT_EQ(coverage.at(-85000).at(0), make_pair(110000000.0, 120000000.0));
+  EXPECT_EQ(getKernelType(spkPath1), "SPK");
+  EXPECT_EQ(getKernelType(ckPath1), "CK");
+}
@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <gtest/gtest.h>
+
+#include "Fixtures.h"
+
+#include "ephemeris.h"
+#include "spice_types.h"
+
+using namespace std;
+using namespace SpiceQL;
+
+
+/**
+ * @brief States on a circular orbit, 7000 km radius with a 90 minute period
+ */
+static targetStates circularOrbit(span<const double> ets) {
+  const double radius = 7000;
+  const double rate = 2 * M_PI / 5400;
+
+  targetStates res;
+  res.n = ets.size();
+  res.data.resize(7 * res.n);
+
+  for (size_t i = 0; i < res.n; i++) {
+    double angle = rate * ets[i];
+    res.data[targetStates::X * res.n + i] = radius * cos(angle);
+    res.data[targetStates::Y * res.n + i] = radius * sin(angle);
+    res.data[targetStates::Z * res.n + i] = 0;
+    res.data[targetStates::VX * res.n + i] = -radius * rate * sin(angle);
+    res.data[targetStates::VY * res.n + i] = radius * rate * cos(angle);
+    res.data[targetStates::VZ * res.n + i] = 0;
+    res.data[targetStates::LT * res.n + i] = ets[i] / 1e6;
+  }
+  return res;
+}
+
+
+TEST(EphemerisTests, UnitTestCachedEphemeris) {
+  CachedEphemeris cache(circularOrbit, 0, 5400, 60);
+
+  EXPECT_EQ(cache.size(), 91);
+  EXPECT_EQ(cache.getSampleCount(), 91 + 90);
+  EXPECT_GT(cache.getMaxError(), 0);
+  EXPECT_LT(cache.getMaxError(), 1e-3);
+
+  vector<double> ets;
+  for (double et = 0; et <= 5400; et += 7.3) {
+    ets.emplace_back(et);
+  }
+  ets.emplace_back(5400);
+
+  targetStates truth = circularOrbit(ets);
+  targetStates states = cache.getStates(ets);
+  ASSERT_EQ(states.n, ets.size());
+
+  for (size_t i = 0; i < ets.size(); i++) {
+    double err = hypot(states.component(targetStates::X)[i] - truth.component(targetStates::X)[i],
+                       states.component(targetStates::Y)[i] - truth.component(targetStates::Y)[i],
+                       states.component(targetStates::Z)[i] - truth.component(targetStates::Z)[i]);
+    EXPECT_LE(err, cache.getMaxError() * 1.01) << "at " << ets[i];
+    EXPECT_NEAR(states.component(targetStates::VX)[i], truth.component(targetStates::VX)[i], 1e-4);
+    EXPECT_NEAR(states.component(targetStates::LT)[i], truth.component(targetStates::LT)[i], 1e-12);
+  }
+
+  // samples are returned exactly
+  targetState state = cache.getState(120);
+  EXPECT_DOUBLE_EQ(state.starg[0], circularOrbit(vector<double>({120})).data[0]);
+
+  // times outside of the cache go to the sampler
+  targetState outside = cache.getState(6000);
+  targetStates expected = circularOrbit(vector<double>({6000}));
+  EXPECT_EQ(outside.starg[0], expected.data[0]);
+  EXPECT_EQ(outside.lt, expected.data[targetStates::LT]);
+}
+
+
+TEST(EphemerisTests, UnitTestCachedEphemerisTolerance) {
+  CachedEphemeris coarse(circularOrbit, 0, 5400, 900);
+  CachedEphemeris refined(circularOrbit, 0, 5400, 900, 1e-4);
+
+  EXPECT_EQ(coarse.size(), 7);
+  EXPECT_GT(coarse.getMaxError(), 1e-4);
+
+  EXPECT_GT(refined.size(), coarse.size());
+  EXPECT_LE(refined.getMaxError(), 1e-4);
+
+  vector<double> ets = {5399, 17, 2700.5, 450};
+  targetStates truth = circularOrbit(ets);
+  targetStates states = refined.getStates(ets);
+
+  for (size_t i = 0; i < ets.size(); i++) {
+    EXPECT_NEAR(states.component(targetStates::X)[i], truth.component(targetStates::X)[i], 1e-4);
+    EXPECT_NEAR(states.component(targetStates::Y)[i], truth.component(targetStates::Y)[i], 1e-4);
+  }
+
+  EXPECT_THROW(CachedEphemeris(circularOrbit, 10, 0, 60), invalid_argument);
+  EXPECT_THROW(CachedEphemeris(circularOrbit, 0, 10, 0), invalid_argument);
+  EXPECT_THROW(CachedEphemeris(circularOrbit, 0, 10, 1, -1), invalid_argument);
+}
+
+
+TEST_F(LroKernelSet, UnitTestCachedEphemeris) {
+  Kernel spk(spkPath1);
+
+  CachedEphemeris cache("-85000", "1", 110000000, 110003600, 60);
+  EXPECT_EQ(cache.size(), 61);
+
+  for (double et : {110000000.0, 110000090.0, 110001234.5, 110003600.0}) {
+    targetState expected = getTargetState(et, "-85000", "1");
+    targetState state = cache.getState(et);
+
+    for (size_t c = 0; c < 3; c++) {
+      EXPECT_NEAR(state.starg[c], expected.starg[c], cache.getMaxError() * 1.01 + 1e-9);
+    }
+  }
+
+  EXPECT_THROW(CachedEphemeris("NOT A BODY", "1", 110000000, 110003600, 60), invalid_argument);
+}
+
+
+/**
+ * @brief Orientations of a spinning frame with a wobbling spin axis
+ *
+ * The frame spins about z at 0.02 rad/s and then rotates about x by 0.3 sin(0.05 t).
+ */
+static size_t wobblingFrame(span<const double> ets, span<double> quats, span<double> avs) {
+  for (size_t i = 0; i < ets.size(); i++) {
+    double spin = 0.02 * ets[i];
+    double wobble = 0.3 * sin(0.05 * ets[i]);
+
+    // product of the spin and wobble quaternions
+    double a0 = cos(spin / 2), a3 = -sin(spin / 2);
+    double b0 = cos(wobble / 2), b1 = -sin(wobble / 2);
+    quats[4 * i] = a0 * b0;
+    quats[4 * i + 1] = a0 * b1;
+    quats[4 * i + 2] = a3 * b1;
+    quats[4 * i + 3] = a3 * b0;
+
+    if (!avs.empty()) {
+      // the wobble rate about x, plus the spin about z rotated about x by the wobble
+      avs[3 * i] = 0.015 * cos(0.05 * ets[i]);
+      avs[3 * i + 1] = -0.02 * sin(wobble);
+      avs[3 * i + 2] = 0.02 * cos(wobble);
+    }
+  }
+  return 0;
+}
+
+
+/**
+ * @brief Same as wobblingFrame, but without angular velocities like when frmchg_ fails
+ */
+static size_t wobblingFrameNoAv(span<const double> ets, span<double> quats, span<double> avs) {
+  wobblingFrame(ets, quats, {});
+  fill(avs.begin(), avs.end(), numeric_limits<double>::quiet_NaN());
+  return avs.empty() ? 0 : ets.size();
+}
+
+
+/**
+ * @brief Get the angle between two quaternions, ignoring their signs
+ */
+static double quatAngle(double const *a, double const *b) {
+  double dot = abs(a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3]);
+  return 2 * acos(min(dot, 1.0));
+}
+
+
+TEST(EphemerisTests, UnitTestCachedOrientation) {
+  vector<double> times;
+  for (double et = 0; et <= 200; et += 10) {
+    times.emplace_back(et);
+  }
+
+  CachedOrientation hermite(wobblingFrame, times);
+  EXPECT_EQ(hermite.size(), 21);
+  EXPECT_EQ(hermite.getDirectIntervals(), 0);
+
+  // without angular velocities only SLERP can be used
+  CachedOrientation slerp(wobblingFrameNoAv, times);
+  EXPECT_LT(hermite.getMaxError(), slerp.getMaxError() / 10);
+
+  vector<double> ets;
+  for (double et = 0; et <= 200; et += 0.7) {
+    ets.emplace_back(et);
+  }
+
+  vector<double> truthQuats(4 * ets.size());
+  vector<double> truthAvs(3 * ets.size());
+  wobblingFrame(ets, truthQuats, truthAvs);
+
+  vector<double> quats(4 * ets.size());
+  vector<double> avs(3 * ets.size());
+  EXPECT_EQ(hermite.getOrientations(ets, quats, avs), 0);
+
+  for (size_t i = 0; i < ets.size(); i++) {
+    EXPECT_LE(quatAngle(&quats[4 * i], &truthQuats[4 * i]), hermite.getMaxError() * 1.5 + 1e-12) << "at " << ets[i];
+    EXPECT_NEAR(avs[3 * i + 2], truthAvs[3 * i + 2], 1e-3);
+  }
+
+  // angular velocities aren't available from the SLERP only cache
+  EXPECT_EQ(slerp.getOrientations(ets, quats, avs), ets.size());
+  EXPECT_EQ(slerp.getOrientations(ets, quats, {}), 0);
+  EXPECT_FALSE(slerp.getOrientation(15).av);
+  EXPECT_TRUE(hermite.getOrientation(15).av);
+
+  vector<double> small(4);
+  EXPECT_THROW(hermite.getOrientations(ets, small, avs), invalid_argument);
+  EXPECT_THROW(CachedOrientation(wobblingFrame, {}), invalid_argument);
+}
+
+
+TEST(EphemerisTests, UnitTestCachedOrientationFallback) {
+  size_t calls = 0;
+  auto counted = [&](span<const double> ets, span<double> quats, span<double> avs) {
+    calls++;
+    return wobblingFrameNoAv(ets, quats, avs);
+  };
+
+  // SLERP isn't accurate enough over 10 seconds, so every interval falls back
+  CachedOrientation cache(counted, {0, 10, 20, 30}, 1e-9);
+  EXPECT_EQ(cache.getDirectIntervals(), 3);
+  EXPECT_EQ(cache.getMaxError(), 0);
+  EXPECT_EQ(calls, 2);
+
+  vector<double> ets = {5, 12.5, 40, 25};
+  vector<double> quats(4 * ets.size());
+  vector<double> truth(4 * ets.size());
+  cache.getOrientations(ets, quats, {});
+  wobblingFrame(ets, truth, {});
+
+  // all of the times are sampled in one call
+  EXPECT_EQ(calls, 3);
+  EXPECT_EQ(quats, truth);
+
+  // samples are returned as is
+  targetOrientation orientation = cache.getOrientation(10);
+  wobblingFrame(vector<double>({10}), truth, {});
+  EXPECT_EQ(vector<double>(orientation.quat.begin(), orientation.quat.end()), vector<double>(truth.begin(), truth.begin() + 4));
+}
@@ -0,0 +1,157 @@
+#include <fstream>
+
+#include <gtest/gtest.h>
+
+#include "Fixtures.h"
+
+#include "inventory.h"
+#include "query.h"
+#include "utils.h"
+
+using namespace std;
+using namespace SpiceQL;
+
+
+TEST_F(TempTestingFiles, UnitTestKernelInventoryBuild) {
+  fs::create_directories(tempDir / "lro" / "kernels" / "ck");
+  fs::create_directories(tempDir / "lro" / "kernels" / "fk");
+  fs::create_directories(tempDir / "base" / "kernels" / "lsk");
+
+  ofstream(tempDir / "lro" / "kernels" / "ck" / "soc31_0000000_0000001_v01.bc") << "ck";
+  ofstream(tempDir / "lro" / "kernels" / "fk" / "lro_frames_1111111_v01.tf") << "fk";
+  ofstream(tempDir / "base" / "kernels" / "lsk" / "naif0012.tls") << "lsk";
+  ofstream(tempDir / "readme.txt") << "readme";
+
+  KernelInventory inventory(tempDir);
+
+  ASSERT_EQ(inventory.getEntries().size(), 4);
+  EXPECT_EQ(inventory.getRoot(), fs::path(tempDir).lexically_normal().string());
+  EXPECT_EQ(inventory.getDirectories().count(tempDir / "lro" / "kernels" / "ck"), 1);
+
+  InventoryEntry ck = inventory.getEntries().at(tempDir / "lro" / "kernels" / "ck" / "soc31_0000000_0000001_v01.bc");
+  EXPECT_EQ(ck.type, "ck");
+  EXPECT_EQ(ck.mission, "lro");
+  EXPECT_EQ(ck.size, 2);
+
+  InventoryEntry lsk = inventory.getEntries().at(tempDir / "base" / "kernels" / "lsk" / "naif0012.tls");
+  EXPECT_EQ(lsk.type, "lsk");
+  EXPECT_EQ(lsk.mission, "base");
+
+  InventoryEntry readme = inventory.getEntries().at(tempDir / "readme.txt");
+  EXPECT_EQ(readme.type, "na");
+  EXPECT_EQ(readme.mission, "");
+
+  EXPECT_EQ(inventory.getEntries("fk").size(), 1);
+  EXPECT_EQ(inventory.glob(regex("naif[0-9]{4}.tls")).size(), 1);
+}
+
+
+TEST_F(TempTestingFiles, UnitTestKernelInventoryRefresh) {
+  fs::path indexPath = tempDir / "index.json";
+  fs::path kernelDir = tempDir / "data" / "lro" / "kernels" / "ik";
+  fs::create_directories(kernelDir);
+
+  ofstream(kernelDir / "lro_lroc_v01.ti") << "ik";
+  ofstream(kernelDir / "lro_lroc_v02.ti") << "ik";
+
+  {
+    KernelInventory inventory(tempDir / "data", indexPath);
+    EXPECT_EQ(inventory.getEntries().size(), 2);
+  }
+
+  ASSERT_TRUE(fs::exists(indexPath));
+
+  // change the data area between processes
+  fs::remove(kernelDir / "lro_lroc_v01.ti");
+  ofstream(kernelDir / "lro_lroc_v02.ti", ios::app) << "more data";
+  fs::create_directories(tempDir / "data" / "lro" / "kernels" / "iak");
+  ofstream(tempDir / "data" / "lro" / "kernels" / "iak" / "lro_instrumentAddendum_v01.ti") << "iak";
+
+  KernelInventory inventory(tempDir / "data", indexPath);
+
+  EXPECT_EQ(inventory.getEntries().size(), 2);
+  EXPECT_EQ(inventory.getEntries().count(kernelDir / "lro_lroc_v01.ti"), 0);
+  EXPECT_EQ(inventory.getEntries().at(kernelDir / "lro_lroc_v02.ti").size, 11);
+  EXPECT_EQ(inventory.getEntries("iak").size(), 1);
+
+  // nothing changed since the last refresh
+  EXPECT_FALSE(inventory.refresh());
+}
+
+
+TEST_F(TempTestingFiles, UnitTestKernelInventoryBadIndex) {
+  fs::path indexPath = tempDir / "index.json";
+  fs::path kernelDir = tempDir / "data" / "lro" / "kernels" / "ik";
+  fs::create_directories(kernelDir);
+  ofstream(kernelDir / "lro_lroc_v01.ti") << "ik";
+
+  nlohmann::json good = KernelInventory(tempDir / "data").toJson();
+
+  nlohmann::json noDirectories = good;
+  noDirectories.erase("directories");
+  nlohmann::json noType = good;
+  noType["kernels"][0].erase("type");
+  nlohmann::json badSize = good;
+  badSize["kernels"][0]["size"] = "big";
+
+  // valid json that isn't a usable index is rebuilt instead of throwing
+  for (nlohmann::json index : {noDirectories, noType, badSize, nlohmann::json::array({1, 2})}) {
+    ofstream(indexPath) << index;
+
+    KernelInventory inventory(tempDir / "data", indexPath);
+    EXPECT_EQ(inventory.getEntries().size(), 1);
+    EXPECT_EQ(nlohmann::json::parse(ifstream(indexPath)), good);
+  }
+}
+
+
+TEST_F(TempTestingFiles, UnitTestKernelInventoryFilter) {
+  fs::path lro = tempDir / "lro" / "kernels";
+  fs::path mess = tempDir / "messenger" / "kernels";
+  fs::create_directories(lro / "fk");
+  fs::create_directories(lro / "ik");
+  fs::create_directories(mess / "fk");
+
+  ofstream(lro / "fk" / "lro_frames_2012255_v02.tf") << "fk";
+  ofstream(lro / "ik" / "lro_lroc_v18.ti") << "ik";
+  // matches the fk pattern, but it's in another mission
+  ofstream(mess / "fk" / "lro_frames_2012256_v02.tf") << "fk";
+
+  KernelInventory inventory(tempDir);
+  EXPECT_EQ(inventory.getPaths().size(), 3);
+  EXPECT_EQ(inventory.getPaths({"fk"}, {}).size(), 2);
+  EXPECT_EQ(inventory.getPaths({"fk"}, {"lro"}), vector<string>({lro / "fk" / "lro_frames_2012255_v02.tf"}));
+  EXPECT_EQ(inventory.getPaths({}, {"lro"}).size(), 2);
+  EXPECT_TRUE(inventory.getPaths({"ck"}, {}).empty());
+
+  nlohmann::json conf = R"({
+    "lroc" : {
+      "fk" : {
+        "kernels" : "lro_frames_[0-9]{7}_v[0-9]{2}.tf"
+      }
+    }
+  })"_json;
+
+  EXPECT_EQ(globKernels(inventory, conf, "fk")["lroc"]["fk"]["kernels"].size(), 2);
+  nlohmann::json res = globKernels(inventory, conf, "fk", {"lro"});
+  ASSERT_EQ(res["lroc"]["fk"]["kernels"].size(), 1);
+  EXPECT_EQ(res["lroc"]["fk"]["kernels"][0], (lro / "fk" / "lro_frames_2012255_v02.tf").string());
+  EXPECT_EQ(searchMissionKernels(inventory, conf, {"lro"}), res);
+
+  // the cached listing follows the index
+  ofstream(lro / "ik" / "lro_lroc_v19.ti") << "ik";
+  EXPECT_TRUE(inventory.refresh());
+  EXPECT_EQ(inventory.getPaths().size(), 4);
+}
+
+
+TEST_F(LroKernelSet, UnitTestSearchMissionKernelsInventory) {
+  KernelInventory inventory(root);
+
+  nlohmann::json expected = searchMissionKernels(root, conf);
+  nlohmann::json res = searchMissionKernels(inventory, conf);
+
+  EXPECT_EQ(res, expected);
+  EXPECT_EQ(res["moc"]["ck"]["reconstructed"]["kernels"].size(), 2);
+  EXPECT_EQ(res["moc"]["spk"]["smithed"]["kernels"].size(), 2);
+}
@@ -45,8 +45,8 @@ TEST_F(LroKernelSet, UnitTestStackedKernelCopyConstructor) {
     // should match what spice counts
     ktotal_c("text", &nkernels);
 
-    // 5 total text kernels, but the lsk should have been loaded 3 times
-    EXPECT_EQ(nkernels, 5);
+    // the lsk is only furnished once, copies only increase the ref count
+    EXPECT_EQ(nkernels, 3);
     EXPECT_EQ(pool.getRefCounts().at(lskPath), 3);
   }
 
@@ -74,16 +74,16 @@ TEST_F(LroKernelSet, UnitTestStackedKernelSetConstructorDestructor) {
 
   // load kernels in a closed call stack
   {
-    // kernels are now loaded twice
+    // kernels are now referenced twice, but only furnished once
     KernelSet k(kernels);
 
     // should match what spice counts
     ktotal_c("text", &nkernels);
-    EXPECT_EQ(nkernels, 8);
+    EXPECT_EQ(nkernels, 5);
     ktotal_c("ck", &nkernels);
-    EXPECT_EQ(nkernels, 2);
+    EXPECT_EQ(nkernels, 1);
     ktotal_c("spk", &nkernels);
-    EXPECT_EQ(nkernels, 2);
+    EXPECT_EQ(nkernels, 1);
 
     // 5 because LSK is not being loaded (yet)
     EXPECT_EQ(pool.getRefCounts().size(), 6);
@@ -111,6 +111,181 @@ TEST_F(LroKernelSet, UnitTestStackedKernelSetConstructorDestructor) {
 }
 
 
+TEST_F(LroKernelSet, UnitTestTypedKernelSet) {
+  // the same pipeline as above without going through json
+  KernelQueryResult kernels = queryMissionKernels(root, conf);
+  kernels = queryMissionKernels(kernels, {110000000, 120000001}, false);
+  kernels = getLatestKernels(kernels);
+
+  KernelSet ks(kernels);
+  KernelSet jsonKs(getLatestKernels(searchMissionKernels(searchMissionKernels(root, conf), {110000000, 120000001}, false)));
+
+  EXPECT_EQ(KernelQueryResult::fromJson(jsonKs.kernels), kernels);
+  EXPECT_EQ(ks.loadedKernels.size(), jsonKs.loadedKernels.size());
+  for (auto &[pointer, loaded] : jsonKs.loadedKernels) {
+    ASSERT_TRUE(ks.loadedKernels.contains(pointer)) << pointer;
+    EXPECT_EQ(ks.loadedKernels.at(pointer).size(), loaded.size()) << pointer;
+  }
+
+  EXPECT_EQ(pool.getRefCount(ckPath1), 2);
+  EXPECT_EQ(pool.getRefCount(spkPath1), 2);
+}
+
+
+TEST_F(LroKernelSet, UnitTestLazyKernelSet) {
+  nlohmann::json kernels = {{"ck", {{"kernels", {ckPath1, ckPath2}}}},
+                            {"spk", {{"kernels", {spkPath1, spkPath2}}}},
+                            {"ik", {{"kernels", {ikPath1}}}}};
+
+  {
+    KernelSet ks(kernels, true);
+
+    // only the text kernels are loaded up front
+    EXPECT_EQ(pool.getRefCount(ikPath1), 1);
+    EXPECT_EQ(pool.getRefCount(ckPath1), 0);
+    EXPECT_EQ(pool.getRefCount(spkPath2), 0);
+    EXPECT_TRUE(ks.getLazyLoadedKernels().empty());
+
+    ks.load(115000000, 115000001);
+    EXPECT_EQ(ks.getLazyLoadedKernels(), std::vector<std::string>({ckPath1, spkPath1}));
+    EXPECT_EQ(pool.getRefCount(ckPath1), 1);
+    EXPECT_EQ(pool.getRefCount(ckPath2), 0);
+
+    // kernels that don't cover the new times are unloaded
+    ks.load(std::vector<double>({135000000}));
+    EXPECT_EQ(ks.getLazyLoadedKernels(), std::vector<std::string>({ckPath2, spkPath2}));
+    EXPECT_EQ(pool.getRefCount(ckPath1), 0);
+    EXPECT_EQ(pool.getRefCount(spkPath2), 1);
+
+    ks.load(110000000, 140000000);
+    EXPECT_EQ(ks.getLazyLoadedKernels(), std::vector<std::string>({ckPath1, ckPath2, spkPath1, spkPath2}));
+
+    int nkernels;
+    ktotal_c("ck", &nkernels);
+    EXPECT_EQ(nkernels, 2);
+  }
+
+  EXPECT_EQ(pool.getRefCount(ckPath1), 0);
+  EXPECT_EQ(pool.getRefCount(spkPath2), 0);
+  EXPECT_EQ(pool.getRefCount(ikPath1), 0);
+}
+
+
+TEST_F(LroKernelSet, UnitTestKernelPriority) {
+  int nkernels;
+
+  Kernel ck1(ckPath1);
+  Kernel ck2(ckPath2);
+  EXPECT_LT(pool.getPriority(ckPath1), pool.getPriority(ckPath2));
+
+  // referencing a loaded kernel doesn't change its priority
+  {
+    Kernel k(ckPath1);
+    EXPECT_LT(pool.getPriority(ckPath1), pool.getPriority(ckPath2));
+  }
+
+  // a set in load order doesn't refurnish anything
+  unsigned long priority1 = pool.getPriority(ckPath1);
+  {
+    KernelSet ks(nlohmann::json({{"ck", {{"kernels", {ckPath1, ckPath2}}}}}));
+    EXPECT_EQ(pool.getPriority(ckPath1), priority1);
+  }
+
+  // a set in another order moves kernels up to match it
+  {
+    KernelSet ks(nlohmann::json({{"ck", {{"kernels", {ckPath2, ckPath1}}}}}));
+    EXPECT_GT(pool.getPriority(ckPath1), pool.getPriority(ckPath2));
+
+    ktotal_c("ck", &nkernels);
+    EXPECT_EQ(nkernels, 2);
+  }
+
+  // and so does an explicit priority load
+  {
+    Kernel k(ckPath2, true);
+    EXPECT_GT(pool.getPriority(ckPath2), pool.getPriority(ckPath1));
+    EXPECT_EQ(pool.getRefCount(ckPath2), 2);
+  }
+
+  ktotal_c("ck", &nkernels);
+  EXPECT_EQ(nkernels, 2);
+}
+
+
+TEST_F(LroKernelSet, UnitTestKernelPoolRetention) {
+  int nkernels;
+  pool.setCapacity(2);
+  pool.resetStats();
+
+  // released kernels stay furnished
+  {
+    Kernel k(ckPath1);
+  }
+  EXPECT_EQ(pool.getRefCount(ckPath1), 0);
+  EXPECT_EQ(pool.getRetainedKernels(), vector<string>({ckPath1}));
+  ktotal_c("ck", &nkernels);
+  EXPECT_EQ(nkernels, 1);
+
+  // and are reused without furnishing them again
+  {
+    Kernel k(ckPath1);
+    EXPECT_EQ(pool.getRefCount(ckPath1), 1);
+    EXPECT_TRUE(pool.getRetainedKernels().empty());
+  }
+
+  KernelPoolStats stats = pool.getStats();
+  EXPECT_EQ(stats.misses, 1);
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.evictions, 0);
+
+  // least recently released kernel goes first
+  {
+    Kernel k(ckPath2);
+  }
+  {
+    Kernel k(spkPath1);
+  }
+  EXPECT_EQ(pool.getRetainedKernels(), vector<string>({spkPath1, ckPath2}));
+  EXPECT_EQ(pool.getStats().evictions, 1);
+  ktotal_c("ck", &nkernels);
+  EXPECT_EQ(nkernels, 1);
+
+  // a capacity of 0 unloads everything that's retained
+  pool.setCapacity(0);
+  EXPECT_TRUE(pool.getRetainedKernels().empty());
+  EXPECT_EQ(pool.getStats().evictions, 3);
+  ktotal_c("ck", &nkernels);
+  EXPECT_EQ(nkernels, 0);
+  ktotal_c("spk", &nkernels);
+  EXPECT_EQ(nkernels, 0);
+}
+
+
+TEST_F(LroKernelSet, UnitTestTimeConverter) {
+  TimeConverter &converter = TimeConverter::getInstance();
+
+  // the LSK is found in the data directory once and stays loaded
+  EXPECT_EQ(converter.getLsk(), lskPath);
+  EXPECT_EQ(pool.getRefCount(lskPath), 1);
+
+  double et = utcToEt("2016-11-26T22:32:14.582000");
+  EXPECT_EQ(pool.getRefCount(lskPath), 1);
+  EXPECT_EQ(etToUtc(et), "2016-11-26T22:32:14.582000");
+  EXPECT_EQ(etToUtc(et, "ISOC", 0), "2016-11-26T22:32:15");
+
+  vector<string> utcs = {"2016-11-26T22:32:14.582000", "2016-11-26T22:33:14.582000", "2016-11-26T22:34:14.582000"};
+  vector<double> ets = utcToEt(utcs);
+  ASSERT_EQ(ets.size(), 3);
+  EXPECT_DOUBLE_EQ(ets[0], et);
+  EXPECT_DOUBLE_EQ(ets[1], et + 60);
+  EXPECT_DOUBLE_EQ(ets[2], et + 120);
+  EXPECT_EQ(etToUtc(ets), utcs);
+
+  converter.release();
+  EXPECT_EQ(pool.getRefCount(lskPath), 0);
+}
+
+
 TEST_F(LroKernelSet, UnitTestStackedKernelPoolGetLoadedKernels) {
   // load all available kernels
   nlohmann::json kernels = searchMissionKernels(root, conf);
@@ -0,0 +1,80 @@
+#include <string>
+#include <thread>
+#include <unordered_set>
+
+#include <gtest/gtest.h>
+
+#include "Fixtures.h"
+
+#include "paths.h"
+
+using namespace std;
+using namespace SpiceQL;
+using json = nlohmann::json;
+
+
+TEST(PathTests, UnitTestKernelPathInterned) {
+  string path = "/isis_data/lro/kernels/ck/lrolc_2009181_2009182_v01.bc";
+  KernelPath a(path);
+  KernelPath b{string_view(path)};
+  KernelPath c = "/isis_data/lro/kernels/ck/lrolc_2009182_2009183_v01.bc";
+
+  // the same path is only stored once
+  size_t size = PathTable::getInstance().size();
+  KernelPath d(path);
+  EXPECT_EQ(PathTable::getInstance().size(), size);
+  EXPECT_EQ(&a.str(), &d.str());
+
+  EXPECT_EQ(a, b);
+  EXPECT_NE(a, c);
+  EXPECT_EQ(a.str(), path);
+  EXPECT_STREQ(a.c_str(), path.c_str());
+  EXPECT_EQ(hash<KernelPath>()(a), hash<KernelPath>()(b));
+
+  // ordered like the strings
+  EXPECT_LT(a, c);
+  EXPECT_GT(c, b);
+
+  EXPECT_TRUE(KernelPath().empty());
+  EXPECT_EQ(KernelPath(), KernelPath(""));
+  EXPECT_EQ(KernelPath(fs::path(path)), a);
+
+  unordered_set<KernelPath> set = {a, b, c, d};
+  EXPECT_EQ(set.size(), 2);
+}
+
+
+TEST(PathTests, UnitTestKernelPathJson) {
+  json j = {"a.bc", "b.bc"};
+  vector<KernelPath> paths = jsonArrayToPaths(j);
+  EXPECT_EQ(paths, vector<KernelPath>({"a.bc", "b.bc"}));
+  EXPECT_EQ(json(paths), j);
+  EXPECT_EQ(j.get<vector<KernelPath>>(), paths);
+
+  EXPECT_EQ(jsonArrayToPaths("a.bc"), vector<KernelPath>({"a.bc"}));
+  EXPECT_THROW(jsonArrayToPaths(json::object()), invalid_argument);
+}
+
+
+TEST(PathTests, UnitTestPathTableThreads) {
+  vector<vector<KernelPath>> paths(4);
+  vector<thread> threads;
+
+  for (size_t t = 0; t < paths.size(); t++) {
+    threads.emplace_back([&paths, t]() {
+      for (int i = 0; i < 1000; i++) {
+        paths[t].emplace_back("threads/kernel" + to_string(i) + ".bc");
+      }
+    });
+  }
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // every thread got the same handles
+  for (size_t t = 1; t < paths.size(); t++) {
+    EXPECT_EQ(paths[t], paths[0]);
+  }
+  EXPECT_EQ(paths[0][10].str(), "threads/kernel10.bc");
+}
@@ -302,4 +302,135 @@ TEST_F(KernelDataDirectories, FunctionalTestSearchMissionKernelsJuno) {
   ASSERT_EQ(res["juno"]["ik"]["kernels"].size(), 1);
   ASSERT_EQ(res["juno"]["iak"]["kernels"].size(), 1);
   ASSERT_EQ(res["juno"]["pck"]["na"]["kernels"].size(), 1);
-}
\ No newline at end of file
+}
+
+TEST_F(KernelDataDirectories, UnitTestSearchMissionKernelsSingleWalk) {
+  fs::path dbPath = getMissionConfigFile("mess");
+
+  ifstream i(dbPath);
+  nlohmann::json conf;
+  i >> conf;
+
+  // every kernel type, category, quality and dependency is matched against a single listing
+  MockRepository mocks;
+  mocks.ExpectCallFunc(ls).Return(paths);
+
+  nlohmann::json res = searchMissionKernels("/isis_data/", conf);
+
+  EXPECT_EQ(res["mdis"]["ck"]["reconstructed"]["kernels"].size(), 4);
+  EXPECT_EQ(res["mess"]["sclk"]["kernels"].size(), 2);
+  EXPECT_EQ(res, searchMissionKernels(paths, conf));
+}
+
+
+TEST_F(TempTestingFiles, UnitTestSearchMissionDirectories) {
+  fs::path lro = tempDir / "lro" / "kernels";
+  fs::create_directories(lro / "fk");
+  fs::create_directories(lro / "ik");
+  fs::create_directories(lro / "ck");
+  fs::create_directories(tempDir / "messenger" / "kernels" / "fk");
+
+  ofstream(lro / "fk" / "lro_frames_2012255_v02.tf") << "fk";
+  ofstream(lro / "ik" / "lro_lroc_v18.ti") << "ik";
+  ofstream(lro / "ck" / "lrolc_2009181_2009182_v01.bc") << "ck";
+  // outside of the lro directory, never walked
+  ofstream(tempDir / "messenger" / "kernels" / "fk" / "lro_frames_2012256_v02.tf") << "fk";
+
+  // the full path matches, but the file name doesn't
+  fs::create_directories(lro / "fk" / "lro_frames_2012257_v02");
+  ofstream(lro / "fk" / "lro_frames_2012257_v02" / "tf.txt") << "readme";
+
+  nlohmann::json conf = R"({
+    "lroc" : {
+      "fk" : {
+        "kernels" : "lro_frames_[0-9]{7}_v[0-9]{2}.tf"
+      },
+      "ik" : {
+        "kernels" : "lro_lroc_v[0-9]{2}.ti"
+      }
+    }
+  })"_json;
+
+  vector<string> dirs = getKernelDirectories(tempDir, conf, {"lro"});
+  ASSERT_EQ(dirs.size(), 2);
+  EXPECT_EQ(dirs.at(0), lro / "fk");
+  EXPECT_EQ(dirs.at(1), lro / "ik");
+
+  // missing missions are skipped without losing the pruning for the others
+  EXPECT_EQ(getKernelDirectories(tempDir, conf, {"lroc", "lro"}), dirs);
+
+  // only when none of them are found does the entire area need to be searched
+  EXPECT_EQ(getKernelDirectories(tempDir, conf, {"lroc"}), vector<string>({tempDir.string()}));
+
+  // a mission without any of the config's kernel types has nothing to search
+  fs::create_directories(tempDir / "clementine1" / "kernels" / "spk");
+  EXPECT_TRUE(getKernelDirectories(tempDir, conf, {"clementine1"}).empty());
+
+  nlohmann::json res = searchMissionDirectories(tempDir, conf, {"lro"});
+  ASSERT_EQ(res["lroc"]["fk"]["kernels"].size(), 1);
+  EXPECT_EQ(res["lroc"]["fk"]["kernels"][0], (lro / "fk" / "lro_frames_2012255_v02.tf").string());
+  EXPECT_EQ(res["lroc"]["ik"]["kernels"].size(), 1);
+}
+
+
+TEST_F(KernelDataDirectories, UnitTestQueryMissionKernelsTyped) {
+  for (auto mission : {"mess", "lro", "clem1", "galileo"}) {
+    nlohmann::json conf;
+    ifstream(getMissionConfigFile(mission)) >> conf;
+
+    KernelQueryResult typed = queryMissionKernels(paths, conf);
+    nlohmann::json res = searchMissionKernels(paths, conf);
+
+    // the json is only a view of the typed results
+    EXPECT_EQ(typed.toJson(), res) << mission;
+    EXPECT_EQ(KernelQueryResult::fromJson(res), typed) << mission;
+  }
+
+  KernelQueryResult typed = queryMissionKernels(paths, getMissionConfig("mess"));
+  const KernelList *ck = typed.find("mdis", "ck", "reconstructed");
+  ASSERT_NE(ck, nullptr);
+  EXPECT_EQ(ck->kernels->size(), 4);
+  EXPECT_EQ(typed.find("mdis", "ck")->objs->size(), 4);
+  EXPECT_EQ(typed.find("mdis", "ck", "predicted"), nullptr);
+  EXPECT_EQ(KernelQueryResult::getPointer("mdis", "ck", "reconstructed"), "/mdis/ck/reconstructed/kernels");
+  EXPECT_EQ(KernelQueryResult().toJson(), nlohmann::json::object());
+}
+
+
+TEST(QueryTests, UnitTestGetLatestKernelsTyped) {
+  nlohmann::json kernels = R"({
+    "inst" : {
+      "ik" : {
+        "kernels" : ["iak.0001.ti", "test/iak.0004.ti", "iak.0003.ti"]
+      },
+      "sclk" : {
+        "kernels" : ["inst_0001.tsc", "inst_0002.tsc"]
+      },
+      "spk" : {
+        "reconstructed" : {
+          "kernels" : ["inst_v01.bsp", "inst_v02.bsp"],
+          "deps" : {
+            "sclk" : ["inst_0001.tsc", "inst_0002.tsc"]
+          }
+        },
+        "smithed" : {
+          "kernels" : []
+        }
+      },
+      "dsk" : {
+        "kernels" : ["inst_v01.bds", "inst_v02.bds"]
+      }
+    }
+  })"_json;
+
+  KernelQueryResult res = getLatestKernels(KernelQueryResult::fromJson(kernels));
+
+  // single kernels are strings in the json
+  EXPECT_EQ(res, KernelQueryResult::fromJson(getLatestKernels(kernels)));
+  EXPECT_EQ(*res.find("inst", "ik")->kernels, vector<KernelPath>({"test/iak.0004.ti"}));
+  EXPECT_EQ(*res.find("inst", "sclk")->kernels, vector<KernelPath>({"inst_0002.tsc"}));
+  EXPECT_EQ(*res.find("inst", "spk", "reconstructed")->kernels, vector<KernelPath>({"inst_v02.bsp"}));
+  EXPECT_EQ(*res.find("inst", "spk", "reconstructed")->sclk, vector<KernelPath>({"inst_0002.tsc"}));
+  EXPECT_TRUE(res.find("inst", "spk", "smithed")->kernels->empty());
+  EXPECT_EQ(res.find("inst", "dsk")->kernels->size(), 2);
+}
@@ -1,3 +1,5 @@
+#include <fstream>
+
 #include <gtest/gtest.h>
 
 #include "utils.h"
@@ -101,3 +103,170 @@ TEST(UtilTests, findKeyInJson) {
   EXPECT_EQ(res.at(1).to_string(), "/l1a/me");
   EXPECT_EQ(res.at(2).to_string(), "/me");
 }
+
+
+TEST(UtilTests, JsonKeyIndex) {
+  nlohmann::json j = R"(
+    {
+      "me" : "test",
+      "l1a" : {
+        "l2a" : [{"me" : 3}, 4],
+        "me" : 2,
+        "l2b" : {
+          "l3a" : "yay",
+          "me" : 1
+        }
+      }
+    })"_json;
+
+  JsonKeyIndex index(j);
+  for (auto &key : {"me", "l2a", "l3a", "0", "missing"}) {
+    EXPECT_EQ(index.find(key), findKeyInJson(j, key, true)) << key;
+    EXPECT_EQ(index.contains(key), !findKeyInJson(j, key, true).empty()) << key;
+  }
+  EXPECT_EQ(index.find("me").at(0).to_string(), "/l1a/l2a/0/me");
+
+  std::vector<std::string> visited;
+  visitKeyInJson(j, "me", [&](nlohmann::json::json_pointer const &p, nlohmann::json const &value) {
+    EXPECT_EQ(j.at(p), value);
+    visited.emplace_back(p.to_string());
+  }, false);
+  EXPECT_EQ(visited, std::vector<std::string>({"/me"}));
+}
+
+
+TEST(UtilTests, PatternSetRequiredLiteral) {
+  EXPECT_EQ(PatternSet::requiredLiteral("lro_frames_[0-9]{7}_v[0-9]{2}.tf"), "lro_frames_");
+  EXPECT_EQ(PatternSet::requiredLiteral("fdf29r?_[0-9]{7}_[0-9]{7}_[nbv][0-9]{2}.bsp"), "fdf29");
+  EXPECT_EQ(PatternSet::requiredLiteral("msgr_mdis_gm[0-9]{6}_[0-9]{6}v[0-9]{1}\\.bc"), "msgr_mdis_gm");
+  EXPECT_EQ(PatternSet::requiredLiteral("[0-9]{5}_[0-9]{5}r*.bc"), "bc");
+  EXPECT_EQ(PatternSet::requiredLiteral("juno_rec(_[0-9]{6}){3}.bsp"), "");
+}
+
+
+TEST(UtilTests, PatternSetMatch) {
+  std::vector<std::string> paths = {
+    "/isis_data/lro/kernels/fk/lro_frames_2012255_v02.tf",
+    "/isis_data/lro/kernels/ik/lro_lroc_v18.ti",
+    "/isis_data/lro/kernels/ik/lro_instruments_v11.ti",
+    "/isis_data/lro/kernels/sclk/lro_clkcor_2020184_v00.tsc"
+  };
+
+  PatternSet set({{"lro_frames_[0-9]{7}_v[0-9]{2}.tf"},
+                  {"lro_lroc_v[0-9]{2}.ti", "lro_instruments_v[0-9]{2}.ti"},
+                  {"lro_clkcor_[0-9]{7}_v[0-9]{2}.tsc", "lro_.*.tsc"},
+                  {"lro_frames_[0-9]{7}_v[0-9]{2}.tf"}});
+
+  EXPECT_EQ(set.match(paths[0]), std::vector<size_t>({0, 3}));
+  EXPECT_EQ(set.match(paths[1]), std::vector<size_t>({1}));
+  EXPECT_EQ(set.match("/isis_data/lro/readme.txt"), std::vector<size_t>());
+
+  std::vector<std::vector<std::string>> res = set.glob(paths);
+  ASSERT_EQ(res.size(), 4);
+  EXPECT_EQ(res[0], std::vector<std::string>({paths[0]}));
+  EXPECT_EQ(res[1], std::vector<std::string>({paths[1], paths[2]}));
+  // a path matching multiple expressions in a group is only added once
+  EXPECT_EQ(res[2], std::vector<std::string>({paths[3]}));
+  EXPECT_EQ(res[3], res[0]);
+
+  EXPECT_EQ(PatternSet::get({{"lro_lroc_v[0-9]{2}.ti"}}), PatternSet::get({{"lro_lroc_v[0-9]{2}.ti"}}));
+}
+
+
+TEST_F(TempTestingFiles, UnitTestWalk) {
+  std::vector<std::string> expected;
+
+  for (int i = 0; i < 20; i++) {
+    fs::path dir = tempDir / ("mission" + std::to_string(i)) / "kernels" / "ck";
+    fs::create_directories(dir);
+    expected.push_back(dir.parent_path().parent_path());
+    expected.push_back(dir.parent_path());
+    expected.push_back(dir);
+
+    for (int j = 0; j < 10; j++) {
+      fs::path kernel = dir / ("kernel" + std::to_string(j) + ".bc");
+      std::ofstream(kernel) << "ck";
+      expected.push_back(kernel);
+    }
+  }
+
+  // symlinked directories are listed but not followed, broken links are skipped
+  fs::create_directory_symlink(tempDir / "mission0", tempDir / "link");
+  fs::create_symlink(tempDir / "missing", tempDir / "broken");
+  expected.push_back(tempDir / "link");
+  std::sort(expected.begin(), expected.end());
+
+  std::vector<std::string> paths;
+  int calls = 0;
+  walk(tempDir, [&](std::vector<std::string> &batch) {
+    calls++;
+    paths.insert(paths.end(), batch.begin(), batch.end());
+  }, true, 4);
+
+  std::sort(paths.begin(), paths.end());
+  EXPECT_EQ(paths, expected);
+  EXPECT_GT(calls, 0);
+
+  EXPECT_EQ(ls(tempDir, true), expected);
+
+  std::vector<std::string> top = ls(tempDir, false);
+  EXPECT_EQ(top.size(), 21);
+  EXPECT_EQ(top.front(), (tempDir / "link").string());
+
+  EXPECT_TRUE(ls(tempDir / "missing", true).empty());
+}
+
+
+TEST_F(LroKernelSet, UnitTestGetTargetStates) {
+  Kernel spk(spkPath1);
+  std::vector<double> ets = {110000000, 115000000, 120000000};
+
+  targetStates states = getTargetStates(ets, "-85000", "1");
+  ASSERT_EQ(states.n, 3);
+  ASSERT_EQ(states.data.size(), 21);
+
+  for (size_t i = 0; i < ets.size(); i++) {
+    targetState expected = getTargetState(ets[i], "-85000", "1");
+
+    EXPECT_DOUBLE_EQ(states.component(targetStates::X)[i], expected.starg[0]);
+    EXPECT_DOUBLE_EQ(states.component(targetStates::Y)[i], expected.starg[1]);
+    EXPECT_DOUBLE_EQ(states.component(targetStates::Z)[i], expected.starg[2]);
+    EXPECT_DOUBLE_EQ(states.component(targetStates::VX)[i], expected.starg[3]);
+    EXPECT_DOUBLE_EQ(states.component(targetStates::VY)[i], expected.starg[4]);
+    EXPECT_DOUBLE_EQ(states.component(targetStates::VZ)[i], expected.starg[5]);
+    EXPECT_DOUBLE_EQ(states.component(targetStates::LT)[i], expected.lt);
+  }
+
+  EXPECT_THROW(getTargetStates(ets, "NOT A BODY", "1"), std::invalid_argument);
+  EXPECT_THROW(getTargetStates(ets, "-85000", "1", "NOT A FRAME"), std::invalid_argument);
+}
+
+
+TEST(UtilTests, getTargetOrientations) {
+  // J2000 to ECLIPJ2000 is built into SPICE, so no kernels are needed
+  std::vector<double> ets = {0, 100000000, 200000000};
+  std::vector<double> quats(4 * ets.size());
+  std::vector<double> avs(3 * ets.size());
+
+  EXPECT_EQ(getTargetOrientations(ets, 17, 1, quats, avs), 0);
+
+  for (size_t i = 0; i < ets.size(); i++) {
+    targetOrientation expected = getTargetOrientation(ets[i], 17, 1);
+    ASSERT_TRUE(expected.av);
+
+    for (size_t j = 0; j < 4; j++) {
+      EXPECT_DOUBLE_EQ(quats[4 * i + j], expected.quat[j]);
+    }
+    for (size_t j = 0; j < 3; j++) {
+      EXPECT_DOUBLE_EQ(avs[3 * i + j], expected.av.value()[j]);
+    }
+  }
+
+  // rotations only
+  std::vector<double> rotationOnly(4 * ets.size());
+  EXPECT_EQ(getTargetOrientations(ets, 17, 1, rotationOnly, {}), 0);
+  EXPECT_EQ(rotationOnly, quats);
+
+  std::vector<double> small(4);
+  EXPECT_THROW(getTargetOrientations(ets, 17, 1, small, avs), std::invalid_argument);
+}
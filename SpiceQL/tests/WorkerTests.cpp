@@ -0,0 +1,169 @@
+#include <fstream>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Fixtures.h"
+
+#include "coverage.h"
+#include "io.h"
+#include "spice_types.h"
+#include "worker.h"
+
+using namespace std;
+using namespace SpiceQL;
+using json = nlohmann::json;
+
+
+TEST(WorkerTests, UnitTestSpiceWorkerSubmit) {
+  SpiceWorker &worker = SpiceWorker::getInstance();
+
+  const int nthreads = 8;
+  const int ntasks = 1000;
+
+  // only touched from the worker thread, so it doesn't need to be atomic
+  int total = 0;
+  vector<thread> threads;
+  vector<vector<future<thread::id>>> results(nthreads);
+
+  for (int t = 0; t < nthreads; t++) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < ntasks; i++) {
+        results[t].emplace_back(worker.submit([&total]() {
+          total++;
+          return this_thread::get_id();
+        }));
+      }
+    });
+  }
+
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  set<thread::id> ids;
+  for (auto &threadResults : results) {
+    for (auto &res : threadResults) {
+      ids.insert(res.get());
+    }
+  }
+
+  EXPECT_EQ(ids.size(), 1);
+  EXPECT_EQ(ids.count(this_thread::get_id()), 0);
+  EXPECT_EQ(worker.submit([&total]() { return total; }).get(), nthreads * ntasks);
+}
+
+
+TEST(WorkerTests, UnitTestSpiceWorkerOrderAndErrors) {
+  SpiceWorker &worker = SpiceWorker::getInstance();
+
+  // tasks from the same thread run in the order they were submitted
+  vector<int> order;
+  vector<future<void>> done;
+  for (int i = 0; i < 100; i++) {
+    done.emplace_back(worker.submit([&order, i]() { order.emplace_back(i); }));
+  }
+  done.back().get();
+
+  ASSERT_EQ(order.size(), 100);
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(order[i], i);
+  }
+
+  future<int> failed = worker.submit([]() -> int { throw invalid_argument("bad query"); });
+  EXPECT_THROW(failed.get(), invalid_argument);
+
+  // submitting from inside a task doesn't deadlock
+  future<int> nested = worker.submit([&worker]() { return worker.submit([]() { return 42; }).get(); });
+  EXPECT_EQ(nested.get(), 42);
+}
+
+
+TEST_F(TempTestingFiles, UnitTestWorkerPoolTimeIntervals) {
+  CoverageCache &cache = CoverageCache::getInstance();
+  cache.clear();
+
+  // coverage cached before the workers are forked is inherited by them
+  vector<string> kernels;
+  vector<vector<pair<double, double>>> expected;
+  for (int i = 0; i < 25; i++) {
+    fs::path kpath = tempDir / ("kernel" + to_string(i) + ".bc");
+    ofstream(kpath) << "not a ck";
+
+    expected.push_back({{i * 10.0, i * 10.0 + 5}});
+    cache.insert(kpath, {{-85000, expected.back()}});
+    kernels.emplace_back(kpath);
+  }
+
+  fs::path textKernel = tempDir / "frames.tf";
+  ofstream(textKernel) << "KPL/FK\n";
+
+  WorkerPool pool(json(), 4);
+  EXPECT_EQ(pool.size(), 4);
+  EXPECT_EQ(pool.getTimeIntervals(kernels), expected);
+  EXPECT_TRUE(pool.getTimeIntervals({}).empty());
+
+  // errors from a worker are rethrown and the pool keeps working
+  vector<string> withText = kernels;
+  withText.emplace_back(textKernel);
+  EXPECT_THROW(pool.getTimeIntervals(withText), invalid_argument);
+  EXPECT_EQ(pool.getTimeIntervals(kernels), expected);
+
+  cache.clear();
+}
+
+
+TEST_F(LroKernelSet, UnitTestWorkerPoolTargetStates) {
+  json kernels = {{"spk", {{"kernels", {spkPath1}}}}};
+  Kernel spk(spkPath1);
+
+  vector<double> ets;
+  for (int i = 0; i < 1000; i++) {
+    ets.emplace_back(110000000 + i * 1000);
+  }
+
+  // a small arena so it takes more than one round
+  WorkerPool pool(kernels, 3, 100 * 8 * sizeof(double));
+  targetStates states = pool.getTargetStates(ets, "-85000", "1");
+  targetStates expected = getTargetStates(ets, "-85000", "1");
+
+  ASSERT_EQ(states.n, ets.size());
+  EXPECT_EQ(states.data, expected.data);
+  EXPECT_THROW(pool.getTargetStates(ets, "NOT A BODY", "1"), invalid_argument);
+}
+
+
+TEST_F(LroKernelSet, UnitTestWorkerPoolKernelOrder) {
+  // same coverage as spkPath1, different states
+  string overlapPath = tempDir / "spk" / "LRO_TEST_OVERLAP.bsp";
+  writeSpk(overlapPath, {{7, 7, 7}, {8, 8, 8}}, {110000000, 120000000}, -85000, 1, "j2000", "SPK ID 3", 1,
+           vector<vector<double>>({{7, 7, 7}, {8, 8, 8}}), "SPK 3");
+
+  size_t capacity = pool.getCapacity();
+  pool.setCapacity(10);
+
+  Kernel spk(spkPath1);
+  {
+    // released, but still furnished and ahead of spkPath1
+    Kernel overlap(overlapPath);
+  }
+  ASSERT_EQ(pool.getRetainedKernels(), vector<string>({overlapPath}));
+
+  vector<string> furnished = pool.getFurnishedKernels();
+  ASSERT_GE(furnished.size(), 2);
+  EXPECT_EQ(furnished.back(), overlapPath);
+  EXPECT_EQ(furnished.at(furnished.size() - 2), spkPath1);
+
+  vector<double> ets = {110000000, 115000000, 120000000};
+  targetStates expected = getTargetStates(ets, "-85000", "1");
+  EXPECT_NEAR(expected.data.at(0), 7, 1e-6);
+
+  // the workers reload the retained kernel, in the same order
+  WorkerPool workers(json(), 2);
+  EXPECT_EQ(workers.getTargetStates(ets, "-85000", "1").data, expected.data);
+
+  pool.setCapacity(capacity);
+}